@@ -5,6 +5,9 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -130,9 +133,12 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  slab_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
+  palloc_print_stats ();
+  malloc_print_stats ();
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
@@ -17,8 +17,10 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.  Written only by the
+   timer interrupt handler; read locklessly through TICKS_SEQ. */
 static int64_t ticks;
+static struct seqlock ticks_seq;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
@@ -35,6 +37,7 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void) 
 {
+  seqlock_init (&ticks_seq);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -70,9 +73,15 @@ timer_calibrate (void)
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  int64_t t;
+  unsigned seq;
+
+  do
+    {
+      seq = seqlock_read_begin (&ticks_seq);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seq, seq));
   return t;
 }
 
@@ -170,7 +179,9 @@ timer_print_stats (void)
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  seqlock_write_begin (&ticks_seq);
   ticks++;
+  seqlock_write_end (&ticks_seq);
   thread_tick ();
 }
 
@@ -1,16 +1,22 @@
 /* cat.c
 
-   Prints files specified on command line to the console. */
+   Prints files specified on command line to the console, or
+   copies standard input to standard output if none are given,
+   so that it can be used in a pipeline. */
 
 #include <stdio.h>
 #include <syscall.h>
 
+static void copy_fd (int fd);
+
 int
 main (int argc, char *argv[]) 
 {
   bool success = true;
   int i;
-  
+
+  if (argc < 2)
+    copy_fd (STDIN_FILENO);
   for (i = 1; i < argc; i++) 
     {
       int fd = open (argv[i]);
@@ -20,15 +26,22 @@ main (int argc, char *argv[])
           success = false;
           continue;
         }
-      for (;;) 
-        {
-          char buffer[1024];
-          int bytes_read = read (fd, buffer, sizeof buffer);
-          if (bytes_read == 0)
-            break;
-          write (STDOUT_FILENO, buffer, bytes_read);
-        }
+      copy_fd (fd);
       close (fd);
     }
   return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+
+/* Copies FD to the console until end of file. */
+static void
+copy_fd (int fd) 
+{
+  for (;;) 
+    {
+      char buffer[1024];
+      int bytes_read = read (fd, buffer, sizeof buffer);
+      if (bytes_read <= 0)
+        break;
+      write (STDOUT_FILENO, buffer, bytes_read);
+    }
+}
@@ -37,14 +37,16 @@ main (int argc, char *argv[])
       return EXIT_FAILURE;
     }
 
-  /* Copy data. */
+  /* Copy data, inside the kernel. */
   for (;;) 
     {
-      char buffer[1024];
-      int bytes_read = read (in_fd, buffer, sizeof buffer);
-      if (bytes_read == 0)
+      int bytes_left = filesize (in_fd) - tell (in_fd);
+      int bytes_copied;
+
+      if (bytes_left <= 0)
         break;
-      if (write (out_fd, buffer, bytes_read) != bytes_read) 
+      bytes_copied = copy_file_range (in_fd, out_fd, bytes_left);
+      if (bytes_copied <= 0) 
         {
           printf ("%s: write failed\n", argv[2]);
           return EXIT_FAILURE;
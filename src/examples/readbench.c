@@ -0,0 +1,119 @@
+/* readbench.c
+
+   Measures how file read throughput scales with the number of
+   processes reading the same file at once.  For each count of
+   readers, starts that many copies of itself, each of which
+   reads the whole file several times, waits for all of them,
+   and prints the aggregate throughput in bytes per thousand CPU
+   cycles.
+
+   Usage: readbench [MAX-READERS] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define FILE_NAME "readbench.dat"
+#define FILE_SIZE (32 * 1024)           /* Bytes in the file. */
+#define PASSES 8                        /* Reads of the file per reader. */
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Reads the file PASSES times.  Run in each child. */
+static int
+reader (void) 
+{
+  static char buffer[4096];
+  int fd = open (FILE_NAME);
+  int pass;
+
+  if (fd < 0)
+    return EXIT_FAILURE;
+  for (pass = 0; pass < PASSES; pass++) 
+    {
+      seek (fd, 0);
+      while (read (fd, buffer, sizeof buffer) > 0)
+        continue;
+    }
+  close (fd);
+  return EXIT_SUCCESS;
+}
+
+/* Creates the file and fills it with data. */
+static bool
+make_file (void) 
+{
+  static char buffer[4096];
+  int fd, i;
+
+  memset (buffer, 'x', sizeof buffer);
+  remove (FILE_NAME);
+  if (!create (FILE_NAME, FILE_SIZE))
+    return false;
+  fd = open (FILE_NAME);
+  if (fd < 0)
+    return false;
+  for (i = 0; i < FILE_SIZE / (int) sizeof buffer; i++)
+    write (fd, buffer, sizeof buffer);
+  close (fd);
+  return true;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int max_readers = 8;
+  int readers;
+
+  if (argc > 1 && !strcmp (argv[1], "-r"))
+    return reader ();
+  if (argc > 1)
+    max_readers = atoi (argv[1]);
+  if (max_readers <= 0) 
+    {
+      printf ("usage: readbench [MAX-READERS]\n");
+      return EXIT_FAILURE;
+    }
+  if (!make_file ()) 
+    {
+      printf ("%s: create failed\n", FILE_NAME);
+      return EXIT_FAILURE;
+    }
+
+  for (readers = 1; readers <= max_readers; readers *= 2) 
+    {
+      pid_t pids[64];
+      uint64_t start, cycles, bytes;
+      int i, started = 0;
+
+      if (readers > (int) (sizeof pids / sizeof *pids))
+        break;
+      start = rdtsc ();
+      for (i = 0; i < readers; i++) 
+        {
+          pids[i] = exec ("readbench -r");
+          if (pids[i] != PID_ERROR)
+            started++;
+        }
+      for (i = 0; i < readers; i++)
+        if (pids[i] != PID_ERROR && wait (pids[i]) != EXIT_SUCCESS)
+          started--;
+      cycles = rdtsc () - start;
+
+      bytes = (uint64_t) started * PASSES * FILE_SIZE;
+      printf ("%d readers: %llu kcycles, %llu bytes/kcycle\n",
+              started, cycles / 1000, bytes * 1000 / (cycles ? cycles : 1));
+    }
+
+  remove (FILE_NAME);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+/* ringbench.c
+
+   Compares the cost of small file writes and reads made with
+   one system call each against the same operations queued in
+   the system call ring, and prints the CPU cycles per operation
+   for each.
+
+   Usage: ringbench [OPS] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+#define FILE_NAME "ringbench.tmp"
+#define OP_SIZE 16                      /* Bytes per read or write. */
+
+static struct ring ring __attribute__ ((aligned (4096)));
+static char buffer[OP_SIZE];
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Performs OPS operations of type OPCODE on FD, one system call
+   each. */
+static void
+run_syscalls (int opcode, int fd, int ops) 
+{
+  int i;
+
+  seek (fd, 0);
+  for (i = 0; i < ops; i++) 
+    {
+      int bytes = (opcode == RING_OP_WRITE
+                   ? write (fd, buffer, sizeof buffer)
+                   : read (fd, buffer, sizeof buffer));
+      if (bytes != sizeof buffer) 
+        {
+          printf ("ringbench: operation %d failed\n", i);
+          exit (EXIT_FAILURE);
+        }
+    }
+}
+
+/* Performs OPS operations of type OPCODE on FD through the ring,
+   a full ring at a time. */
+static void
+run_ring (int opcode, int fd, int ops) 
+{
+  int done = 0;
+
+  seek (fd, 0);
+  while (done < ops) 
+    {
+      int batch = ops - done < RING_ENTRIES ? ops - done : RING_ENTRIES;
+      int i;
+
+      for (i = 0; i < batch; i++) 
+        {
+          struct ring_sqe *sqe = &ring.sq[ring.sq_tail++ & RING_MASK];
+          sqe->opcode = opcode;
+          sqe->fd = fd;
+          sqe->buf = buffer;
+          sqe->len = sizeof buffer;
+          sqe->user_data = done + i;
+        }
+      if (ring_enter (batch) != batch) 
+        {
+          printf ("ringbench: ring_enter failed\n");
+          exit (EXIT_FAILURE);
+        }
+      for (i = 0; i < batch; i++) 
+        {
+          struct ring_cqe *cqe = &ring.cq[ring.cq_head++ & RING_MASK];
+          if (cqe->result != sizeof buffer) 
+            {
+              printf ("ringbench: operation %u failed\n", cqe->user_data);
+              exit (EXIT_FAILURE);
+            }
+        }
+      done += batch;
+    }
+}
+
+/* Times OPS operations of type OPCODE on FD both ways and
+   prints the results under NAME. */
+static void
+compare (const char *name, int opcode, int fd, int ops) 
+{
+  uint64_t start, syscall_cycles, ring_cycles;
+
+  start = rdtsc ();
+  run_syscalls (opcode, fd, ops);
+  syscall_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  run_ring (opcode, fd, ops);
+  ring_cycles = rdtsc () - start;
+
+  printf ("%s: %llu cycles/op with system calls, %llu with the ring\n",
+          name, syscall_cycles / ops, ring_cycles / ops);
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int ops = argc > 1 ? atoi (argv[1]) : 1024;
+  int fd;
+
+  if (ops <= 0) 
+    {
+      printf ("usage: ringbench [OPS]\n");
+      return EXIT_FAILURE;
+    }
+  if (!ring_setup (&ring)) 
+    {
+      printf ("ringbench: ring_setup failed\n");
+      return EXIT_FAILURE;
+    }
+  if (!create (FILE_NAME, ops * OP_SIZE)) 
+    {
+      printf ("%s: create failed\n", FILE_NAME);
+      return EXIT_FAILURE;
+    }
+  fd = open (FILE_NAME);
+  if (fd < 0) 
+    {
+      printf ("%s: open failed\n", FILE_NAME);
+      return EXIT_FAILURE;
+    }
+
+  printf ("ringbench: %d operations of %d bytes\n", ops, OP_SIZE);
+  compare ("write", RING_OP_WRITE, fd, ops);
+  compare ("read", RING_OP_READ, fd, ops);
+
+  close (fd);
+  remove (FILE_NAME);
+  return EXIT_SUCCESS;
+}
@@ -3,8 +3,12 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Maximum number of commands in a pipeline. */
+#define MAX_STAGES 8
+
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char *command);
 
 int
 main (void)
@@ -30,6 +34,8 @@ main (void)
         {
           /* Empty command. */
         }
+      else if (strchr (command, '|') != NULL)
+        run_pipeline (command);
       else
         {
           pid_t pid = exec (command);
@@ -44,6 +50,84 @@ main (void)
   return EXIT_SUCCESS;
 }
 
+/* Runs COMMAND, a series of commands separated by `|', with the
+   standard output of each connected to the standard input of
+   the next through a pipe, and waits for all of them.  Each
+   command inherits the shell's descriptors as they stand when it
+   is started, so the shell points its own descriptors 0 and 1 at
+   the right pipe ends around each exec() and then restores
+   them. */
+static void
+run_pipeline (char *command) 
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0;
+  int saved_stdin, saved_stdout;
+  char *stage, *save_ptr;
+  int i;
+
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr)) 
+    {
+      while (*stage == ' ')
+        stage++;
+      if (*stage == '\0' || stage_cnt >= MAX_STAGES) 
+        {
+          printf ("bad pipeline\n");
+          return;
+        }
+      stages[stage_cnt++] = stage;
+    }
+
+  saved_stdin = dup (STDIN_FILENO);
+  saved_stdout = dup (STDOUT_FILENO);
+  if (saved_stdin < 0 || saved_stdout < 0) 
+    {
+      printf ("dup failed\n");
+      close (saved_stdin);
+      close (saved_stdout);
+      return;
+    }
+
+  for (i = 0; i < stage_cnt; i++) 
+    {
+      int fds[2];
+      bool piped = i < stage_cnt - 1 && pipe (fds);
+
+      if (piped) 
+        {
+          dup2 (fds[1], STDOUT_FILENO);
+          close (fds[1]);
+        }
+      else
+        dup2 (saved_stdout, STDOUT_FILENO);
+
+      pids[i] = exec (stages[i]);
+
+      if (piped) 
+        {
+          dup2 (fds[0], STDIN_FILENO);
+          close (fds[0]);
+        }
+      else
+        dup2 (saved_stdin, STDIN_FILENO);
+    }
+
+  /* Restore the shell's descriptors, dropping its references to
+     the last pipe so that the commands see end of file. */
+  dup2 (saved_stdin, STDIN_FILENO);
+  dup2 (saved_stdout, STDOUT_FILENO);
+  close (saved_stdin);
+  close (saved_stdout);
+
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+    else
+      printf ("\"%s\": exec failed\n", stages[i]);
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
@@ -4,7 +4,8 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir 
@@ -21,6 +22,24 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Cache of `struct dir's. */
+static struct slab_cache dir_cache;
+
+/* Namespace lock.  Held for reading while looking up or listing
+   names and for writing while adding or removing them, so that
+   checking whether a name exists and then creating it is
+   atomic.  (The file system has a single directory, so one lock
+   does not cost any concurrency.) */
+static struct rwlock dir_lock;
+
+/* Initializes the directory module. */
+void
+dir_init (void) 
+{
+  slab_cache_init (&dir_cache, "dir", sizeof (struct dir), NULL);
+  rwlock_init (&dir_lock);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -34,7 +53,7 @@ dir_create (block_sector_t sector, size_t entry_cnt)
 struct dir *
 dir_open (struct inode *inode) 
 {
-  struct dir *dir = calloc (1, sizeof *dir);
+  struct dir *dir = slab_alloc (&dir_cache);
   if (inode != NULL && dir != NULL)
     {
       dir->inode = inode;
@@ -44,7 +63,7 @@ dir_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (dir);
+      slab_free (&dir_cache, dir);
       return NULL; 
     }
 }
@@ -72,7 +91,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
     {
       inode_close (dir->inode);
-      free (dir);
+      slab_free (&dir_cache, dir);
     }
 }
 
@@ -124,10 +143,12 @@ dir_lookup (const struct dir *dir, const char *name,
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  rwlock_acquire_read (&dir_lock);
   if (lookup (dir, name, &e, NULL))
     *inode = inode_open (e.inode_sector);
   else
     *inode = NULL;
+  rwlock_release_read (&dir_lock);
 
   return *inode != NULL;
 }
@@ -153,6 +174,7 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
     return false;
 
   /* Check that NAME is not in use. */
+  rwlock_acquire_write (&dir_lock);
   if (lookup (dir, name, NULL, NULL))
     goto done;
 
@@ -175,6 +197,7 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
  done:
+  rwlock_release_write (&dir_lock);
   return success;
 }
 
@@ -193,6 +216,7 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (name != NULL);
 
   /* Find directory entry. */
+  rwlock_acquire_write (&dir_lock);
   if (!lookup (dir, name, &e, &ofs))
     goto done;
 
@@ -211,6 +235,7 @@ dir_remove (struct dir *dir, const char *name)
   success = true;
 
  done:
+  rwlock_release_write (&dir_lock);
   inode_close (inode);
   return success;
 }
@@ -222,15 +247,19 @@ bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
+  bool found = false;
 
+  rwlock_acquire_read (&dir_lock);
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
     {
       dir->pos += sizeof e;
       if (e.in_use)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
+          found = true;
+          break;
         } 
     }
-  return false;
+  rwlock_release_read (&dir_lock);
+  return found;
 }
@@ -1,8 +1,10 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include "devices/block.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
-#include "userprog/syscall.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
 
 /* An open file. */
 struct file 
@@ -12,13 +14,23 @@ struct file
     bool deny_write;            /* Has file_deny_write() been called? */
   };
 
+/* Cache of `struct file's. */
+static struct slab_cache file_cache;
+
+/* Initializes the open file module. */
+void
+file_init (void) 
+{
+  slab_cache_init (&file_cache, "file", sizeof (struct file), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) 
 {
-  struct file *file = calloc (1, sizeof *file);
+  struct file *file = slab_alloc (&file_cache);
   if (inode != NULL && file != NULL)
     {
       file->inode = inode;
@@ -29,7 +41,7 @@ file_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (file);
+      slab_free (&file_cache, file);
       return NULL; 
     }
 }
@@ -50,7 +62,7 @@ file_close (struct file *file)
     {
       file_allow_write (file);
       inode_close (file->inode);
-      free (file); 
+      slab_free (&file_cache, file); 
     }
 }
 
@@ -114,6 +126,55 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+   position, into DST, starting at its current position, and
+   advances both positions past the bytes copied.  Returns the
+   number of bytes copied, which may be less than SIZE if end of
+   file is reached in either file or memory is short.
+
+   The data is moved through a kernel page, in chunks that end on
+   a sector boundary of SRC, so that when the two positions are
+   equally aligned within a sector every sector goes straight
+   between the disk and the page. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size) 
+{
+  uint8_t *buffer;
+  off_t copied = 0;
+
+  ASSERT (dst != NULL);
+  ASSERT (src != NULL);
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return 0;
+
+  while (copied < size)
+    {
+      off_t chunk = PGSIZE - src->pos % BLOCK_SECTOR_SIZE;
+      off_t bytes_read, bytes_written;
+
+      if (chunk > size - copied)
+        chunk = size - copied;
+      bytes_read = file_read (src, buffer, chunk);
+      if (bytes_read == 0)
+        break;
+      bytes_written = file_write (dst, buffer, bytes_read);
+      copied += bytes_written;
+      if (bytes_written < bytes_read)
+        {
+          /* Leave SRC just past what made it into DST. */
+          src->pos -= bytes_read - bytes_written;
+          break;
+        }
+      if (bytes_read < chunk)
+        break;
+    }
+
+  palloc_free_page (buffer);
+  return copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
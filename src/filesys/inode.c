@@ -6,6 +6,8 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -28,7 +30,16 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
-/* In-memory inode. */
+/* In-memory inode.
+
+   ELEM, OPEN_CNT, REMOVED and DENY_WRITE_CNT are protected by
+   OPEN_INODES_LOCK.  The file's data is protected by RW:
+   inode_read_at() holds it for reading and inode_write_at() for
+   writing, so that reads of one file may overlap each other, and
+   accesses to different files never wait for each other.
+   DENY_WRITE_CNT is not changed under RW, because a thread
+   waiting for RW as a writer holds up new readers, including
+   page faults that read the same executable. */
 struct inode 
   {
     struct list_elem elem;              /* Element in inode list. */
@@ -36,6 +47,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct rwlock rw;                   /* Protects file data. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -56,12 +68,18 @@ byte_to_sector (const struct inode *inode, off_t pos)
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
+
+/* Cache of `struct inode's. */
+static struct slab_cache inode_cache;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
+  slab_cache_init (&inode_cache, "inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -105,39 +123,69 @@ inode_create (block_sector_t sector, off_t length)
   return success;
 }
 
-/* Reads an inode from SECTOR
-   and returns a `struct inode' that contains it.
-   Returns a null pointer if memory allocation fails. */
-struct inode *
-inode_open (block_sector_t sector)
+/* Returns the open inode for SECTOR with its open count
+   incremented, or a null pointer if it is not open.
+   OPEN_INODES_LOCK must be held. */
+static struct inode *
+find_open_inode (block_sector_t sector) 
 {
   struct list_elem *e;
-  struct inode *inode;
 
-  /* Check whether this inode is already open. */
+  ASSERT (lock_held_by_current_thread (&open_inodes_lock));
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
     {
-      inode = list_entry (e, struct inode, elem);
+      struct inode *inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
-          inode_reopen (inode);
+          inode->open_cnt++;
           return inode; 
         }
     }
+  return NULL;
+}
+
+/* Reads an inode from SECTOR
+   and returns a `struct inode' that contains it.
+   Returns a null pointer if memory allocation fails. */
+struct inode *
+inode_open (block_sector_t sector)
+{
+  struct inode *inode, *other;
+
+  /* Check whether this inode is already open. */
+  lock_acquire (&open_inodes_lock);
+  inode = find_open_inode (sector);
+  lock_release (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = slab_alloc (&inode_cache);
   if (inode == NULL)
     return NULL;
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize.  The inode is read without the lock held, so
+     that opens of other inodes do not wait for the disk, and
+     only then published.  If another thread opened the same
+     inode meanwhile, use its copy instead. */
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  rwlock_init (&inode->rw);
   block_read (fs_device, inode->sector, &inode->data);
+
+  lock_acquire (&open_inodes_lock);
+  other = find_open_inode (sector);
+  if (other == NULL)
+    list_push_front (&open_inodes, &inode->elem);
+  lock_release (&open_inodes_lock);
+  if (other != NULL)
+    {
+      slab_free (&inode_cache, inode);
+      return other;
+    }
   return inode;
 }
 
@@ -146,7 +194,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -168,10 +220,12 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      lock_release (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -181,8 +235,10 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      slab_free (&inode_cache, inode); 
     }
+  else
+    lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -191,7 +247,9 @@ void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  lock_acquire (&open_inodes_lock);
   inode->removed = true;
+  lock_release (&open_inodes_lock);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -204,6 +262,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  rwlock_acquire_read (&inode->rw);
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -244,6 +303,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  rwlock_release_read (&inode->rw);
   free (bounce);
 
   return bytes_read;
@@ -262,8 +322,17 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
 
+  /* Check before taking the lock as well as after, so that
+     attempts to write a running executable do not queue up
+     behind (and hold up) the page faults that read it. */
   if (inode->deny_write_cnt)
     return 0;
+  rwlock_acquire_write (&inode->rw);
+  if (inode->deny_write_cnt)
+    {
+      rwlock_release_write (&inode->rw);
+      return 0;
+    }
 
   while (size > 0) 
     {
@@ -312,6 +381,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+  rwlock_release_write (&inode->rw);
   free (bounce);
 
   return bytes_written;
@@ -322,8 +392,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  lock_acquire (&open_inodes_lock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  lock_release (&open_inodes_lock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,9 +404,11 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  lock_acquire (&open_inodes_lock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  lock_release (&open_inodes_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -0,0 +1,61 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+/* System call ring.
+
+   A process that makes many small system calls can queue them in
+   a ring shared with the kernel instead of trapping once per
+   call.  It registers a page-aligned struct ring with
+   ring_setup(), fills submission entries at SQ_TAIL, and calls
+   ring_enter() to have the kernel carry out a batch of them in a
+   single trap.  The kernel consumes entries at SQ_HEAD and posts
+   one completion per entry at CQ_TAIL, which the process reaps
+   at CQ_HEAD.
+
+   The four indexes run freely and wrap around; an index refers
+   to slot (index & RING_MASK).  Each side only ever writes the
+   indexes it owns. */
+
+/* Operations. */
+enum ring_op
+  {
+    RING_OP_READ,               /* read (fd, buf, len). */
+    RING_OP_WRITE,              /* write (fd, buf, len). */
+    RING_OP_OPEN,               /* open (buf). */
+    RING_OP_CLOSE               /* close (fd). */
+  };
+
+/* A submission queue entry. */
+struct ring_sqe
+  {
+    int opcode;                 /* An enum ring_op. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Buffer, or file name for RING_OP_OPEN. */
+    unsigned len;               /* Size of BUF in bytes. */
+    unsigned user_data;         /* Passed back in the completion. */
+  };
+
+/* A completion queue entry. */
+struct ring_cqe
+  {
+    int result;                 /* What the system call returned. */
+    unsigned user_data;         /* From the submission. */
+  };
+
+/* Number of entries in each queue.  Must be a power of 2, small
+   enough that a struct ring fits in one page. */
+#define RING_ENTRIES 128
+#define RING_MASK (RING_ENTRIES - 1)
+
+/* Submission and completion queues. */
+struct ring
+  {
+    unsigned sq_head;           /* Next submission to run (kernel). */
+    unsigned sq_tail;           /* Next free submission slot (user). */
+    unsigned cq_head;           /* Next completion to reap (user). */
+    unsigned cq_tail;           /* Next free completion slot (kernel). */
+    struct ring_sqe sq[RING_ENTRIES];
+    struct ring_cqe cq[RING_ENTRIES];
+  };
+
+#endif /* lib/ring.h */
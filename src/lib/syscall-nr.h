@@ -28,7 +28,19 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_PREAD,                  /* Read from a file at an offset. */
+    SYS_PWRITE,                 /* Write to a file at an offset. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write several buffers to a file. */
+    SYS_COPY_FILE_RANGE,        /* Copy data from one file to another. */
+    SYS_RING_SETUP,             /* Register a system call ring. */
+    SYS_RING_ENTER,             /* Run queued system calls. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_DUP,                    /* Duplicate a file descriptor. */
+    SYS_DUP2                    /* Duplicate onto a given descriptor. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,120 @@
+/* Runs several threads that allocate and free small blocks with
+   malloc() as fast as they can, all at once, and reports how
+   many timer ticks they took.  Each thread fills its blocks with
+   its own pattern and checks it before freeing them, so the test
+   also catches blocks being handed to two threads at once.  The
+   timing is for reading, not checking. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of contending threads. */
+#define THREAD_CNT 4
+
+/* Number of blocks each thread holds at once. */
+#define HELD_CNT 32
+
+/* Number of malloc()/free() pairs per thread. */
+#define ROUND_CNT 20000
+
+struct worker
+  {
+    int id;                     /* Fill pattern. */
+    struct semaphore *start;    /* Upped once for each worker. */
+    struct semaphore *done;     /* Upped by each worker. */
+    bool ok;                    /* Did all the checks pass? */
+  };
+
+static thread_func malloc_worker;
+
+void
+test_malloc_throughput (void) 
+{
+  struct worker workers[THREAD_CNT];
+  struct semaphore start, done;
+  int64_t start_time;
+  int i;
+
+  sema_init (&start, 0);
+  sema_init (&done, 0);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+
+      workers[i].id = i + 1;
+      workers[i].start = &start;
+      workers[i].done = &done;
+      workers[i].ok = true;
+      snprintf (name, sizeof name, "malloc %d", i);
+      thread_create (name, PRI_DEFAULT, malloc_worker, &workers[i]);
+    }
+
+  start_time = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_up (&start);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  msg ("%d threads: %d allocations in %"PRId64" ticks",
+       THREAD_CNT, THREAD_CNT * ROUND_CNT, timer_elapsed (start_time));
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (!workers[i].ok)
+      fail ("thread %d found a corrupted block", i);
+  pass ();
+}
+
+/* Checks that the SIZE bytes at BLOCK all equal ID. */
+static bool
+check_block (const uint8_t *block, size_t size, int id) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (block[i] != id)
+      return false;
+  return true;
+}
+
+static void
+malloc_worker (void *w_) 
+{
+  struct worker *w = w_;
+  uint8_t *held[HELD_CNT];
+  size_t sizes[HELD_CNT];
+  int i;
+
+  memset (held, 0, sizeof held);
+  sema_down (w->start);
+  for (i = 0; i < ROUND_CNT; i++) 
+    {
+      int slot = random_ulong () % HELD_CNT;
+
+      if (held[slot] != NULL) 
+        {
+          if (!check_block (held[slot], sizes[slot], w->id))
+            w->ok = false;
+          free (held[slot]);
+        }
+      sizes[slot] = random_ulong () % 128 + 1;
+      held[slot] = malloc (sizes[slot]);
+      if (held[slot] == NULL)
+        w->ok = false;
+      else
+        memset (held[slot], w->id, sizes[slot]);
+
+      /* Let the others at the allocator now and then. */
+      if (i % 256 == 0)
+        thread_yield ();
+    }
+  for (i = 0; i < HELD_CNT; i++)
+    free (held[i]);
+  sema_up (w->done);
+}
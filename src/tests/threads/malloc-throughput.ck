@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+fail "missing timing\n"
+  if !grep (/^\(malloc-throughput\) \d+ threads: \d+ allocations in \d+ ticks$/,
+            @output);
+fail "missing PASS\n" if !grep (/^\(malloc-throughput\) PASS$/, @output);
+pass;
@@ -0,0 +1,143 @@
+/* Compares the buddy page allocator in threads/palloc.c with the
+   first-fit bitmap scan it replaced.  Both allocators run the
+   same random mix of 1- to 4-page allocations and frees against
+   a partly full pool, and the number of timer ticks each takes
+   is reported.  The test fails only if the real allocator loses
+   or corrupts pages; the timings are for reading, not checking. */
+
+#include <bitmap.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Number of allocations held at any time. */
+#define HELD_CNT 48
+
+/* Number of free-then-allocate steps. */
+#define STEP_CNT 50000
+
+/* An allocator under test. */
+struct allocator
+  {
+    const char *name;
+    void *(*get) (size_t page_cnt);
+    void (*free) (void *, size_t page_cnt);
+  };
+
+static void *buddy_get (size_t);
+static void buddy_free (void *, size_t);
+static void *bitmap_get (size_t);
+static void bitmap_free (void *, size_t);
+static int64_t run_bench (const struct allocator *);
+
+/* The old allocator, over a bitmap as large as the kernel pool. */
+static struct bitmap *used_map;
+static struct lock map_lock;
+static uint8_t *poison_page;
+
+void
+test_palloc_bench (void) 
+{
+  static const struct allocator buddy = {"buddy", buddy_get, buddy_free};
+  static const struct allocator first_fit =
+    {"bitmap", bitmap_get, bitmap_free};
+  size_t free_before = palloc_free_cnt (0);
+  int64_t buddy_ticks, bitmap_ticks;
+
+  used_map = bitmap_create (free_before);
+  poison_page = malloc (PGSIZE);
+  ASSERT (used_map != NULL && poison_page != NULL);
+  lock_init (&map_lock);
+
+  buddy_ticks = run_bench (&buddy);
+  bitmap_ticks = run_bench (&first_fit);
+
+  msg ("%s: %"PRId64" ticks for %d steps", buddy.name, buddy_ticks, STEP_CNT);
+  msg ("%s: %"PRId64" ticks for %d steps",
+       first_fit.name, bitmap_ticks, STEP_CNT);
+
+  bitmap_destroy (used_map);
+  free (poison_page);
+
+  if (palloc_free_cnt (0) != free_before)
+    fail ("%zu pages free before, %zu after",
+          free_before, palloc_free_cnt (0));
+  pass ();
+}
+
+/* Runs the benchmark on allocator A and returns the number of
+   timer ticks it took. */
+static int64_t
+run_bench (const struct allocator *a) 
+{
+  static void *held[HELD_CNT];
+  static size_t sizes[HELD_CNT];
+  int64_t start;
+  size_t i;
+
+  random_init (0);
+  memset (sizes, 0, sizeof sizes);
+
+  start = timer_ticks ();
+  for (i = 0; i < STEP_CNT; i++) 
+    {
+      size_t slot = random_ulong () % HELD_CNT;
+
+      if (sizes[slot] != 0)
+        a->free (held[slot], sizes[slot]);
+      sizes[slot] = random_ulong () % 4 + 1;
+      held[slot] = a->get (sizes[slot]);
+      if (held[slot] == NULL)
+        sizes[slot] = 0;
+    }
+  for (i = 0; i < HELD_CNT; i++)
+    if (sizes[i] != 0)
+      a->free (held[i], sizes[i]);
+  return timer_elapsed (start);
+}
+
+static void *
+buddy_get (size_t page_cnt) 
+{
+  return palloc_get_multiple (0, page_cnt);
+}
+
+static void
+buddy_free (void *pages, size_t page_cnt) 
+{
+  palloc_free_multiple (pages, page_cnt);
+}
+
+/* Allocates as palloc_get_multiple() used to.  Returns a fake,
+   nonnull "address": one more than the first page's index. */
+static void *
+bitmap_get (size_t page_cnt) 
+{
+  size_t idx;
+
+  lock_acquire (&map_lock);
+  idx = bitmap_scan_and_flip (used_map, 0, page_cnt, false);
+  lock_release (&map_lock);
+  return idx != BITMAP_ERROR ? (void *) (idx + 1) : NULL;
+}
+
+/* Frees as palloc_free_multiple() used to, including poisoning
+   the freed pages, so that the comparison is fair. */
+static void
+bitmap_free (void *pages, size_t page_cnt) 
+{
+  size_t idx = (size_t) pages - 1;
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    memset (poison_page, 0xcc, PGSIZE);
+  ASSERT (bitmap_all (used_map, idx, page_cnt));
+  bitmap_set_multiple (used_map, idx, page_cnt, false);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+foreach my $name (qw (buddy bitmap)) {
+    fail "missing timing for $name allocator\n"
+      if !grep (/^\(palloc-bench\) $name: \d+ ticks/, @output);
+}
+fail "missing PASS\n" if !grep (/^\(palloc-bench\) PASS$/, @output);
+pass;
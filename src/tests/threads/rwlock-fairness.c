@@ -0,0 +1,97 @@
+/* Checks the order in which a readers-writer lock admits
+   waiting threads.  While the main thread holds the lock for
+   writing, a low-priority writer, a reader, and a high-priority
+   writer queue up for it, in that order.  Once the main thread
+   lets go, both writers must get in before the reader, even
+   though the reader arrived before the second writer, and the
+   high-priority writer must go first.  A reader that arrives
+   while the lock is held for reading and a writer is waiting
+   must also wait for the writer. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static struct rwlock rw;
+
+/* Names of the threads that got the lock, in order. */
+static const char *order[8];
+static size_t order_cnt;
+
+static void
+record (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  order[order_cnt++] = thread_name ();
+  intr_set_level (old_level);
+}
+
+static void
+writer (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rw);
+  record ();
+  rwlock_release_write (&rw);
+}
+
+static void
+reader (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rw);
+  record ();
+  rwlock_release_read (&rw);
+}
+
+/* Lets every other ready thread run until it blocks. */
+static void
+let_others_run (void) 
+{
+  int i;
+
+  for (i = 0; i < 8; i++)
+    thread_yield ();
+}
+
+static void
+print_order (void) 
+{
+  size_t i;
+
+  for (i = 0; i < order_cnt; i++)
+    msg ("%s", order[i]);
+  order_cnt = 0;
+}
+
+void
+test_rwlock_fairness (void) 
+{
+  rwlock_init (&rw);
+
+  msg ("Writers ahead of readers, highest priority first:");
+  rwlock_acquire_write (&rw);
+  thread_create ("low writer", PRI_DEFAULT - 1, writer, NULL);
+  let_others_run ();
+  thread_create ("reader", PRI_DEFAULT, reader, NULL);
+  let_others_run ();
+  thread_create ("high writer", PRI_DEFAULT + 1, writer, NULL);
+  let_others_run ();
+  rwlock_release_write (&rw);
+  let_others_run ();
+  print_order ();
+
+  msg ("A waiting writer holds off new readers:");
+  rwlock_acquire_read (&rw);
+  thread_create ("writer", PRI_DEFAULT, writer, NULL);
+  let_others_run ();
+  thread_create ("late reader", PRI_DEFAULT, reader, NULL);
+  let_others_run ();
+  if (order_cnt != 0)
+    fail ("%s got in while the lock was held for reading", order[0]);
+  rwlock_release_read (&rw);
+  let_others_run ();
+  print_order ();
+
+  pass ();
+}
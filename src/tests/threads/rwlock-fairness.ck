@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-fairness) begin
+(rwlock-fairness) Writers ahead of readers, highest priority first:
+(rwlock-fairness) high writer
+(rwlock-fairness) low writer
+(rwlock-fairness) reader
+(rwlock-fairness) A waiting writer holds off new readers:
+(rwlock-fairness) writer
+(rwlock-fairness) late reader
+(rwlock-fairness) PASS
+(rwlock-fairness) end
+EOF
+pass;
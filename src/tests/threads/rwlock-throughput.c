@@ -0,0 +1,112 @@
+/* Runs several reader threads and a writer thread against one
+   readers-writer lock and reports how many acquisitions they
+   managed in a fixed number of rounds and how long that took.
+   Readers yield the CPU while holding the lock, so other readers
+   should get in alongside them; the test checks that they did,
+   and that no reader ever saw a write half done. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of reader threads. */
+#define READER_CNT 4
+
+/* Number of acquisitions per thread. */
+#define ROUND_CNT 2000
+
+static struct rwlock rw;
+
+/* Protected by RW.  The writer keeps them equal. */
+static int value_a, value_b;
+
+/* Readers currently inside and the most ever inside at once. */
+static int readers_in, max_readers_in;
+
+/* Did any reader see VALUE_A != VALUE_B? */
+static bool torn;
+
+static struct semaphore start, done;
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  int i;
+
+  sema_down (&start);
+  for (i = 0; i < ROUND_CNT; i++) 
+    {
+      enum intr_level old_level;
+
+      rwlock_acquire_read (&rw);
+      old_level = intr_disable ();
+      if (++readers_in > max_readers_in)
+        max_readers_in = readers_in;
+      intr_set_level (old_level);
+
+      if (value_a != value_b)
+        torn = true;
+      thread_yield ();
+      if (value_a != value_b)
+        torn = true;
+
+      old_level = intr_disable ();
+      readers_in--;
+      intr_set_level (old_level);
+      rwlock_release_read (&rw);
+    }
+  sema_up (&done);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  int i;
+
+  sema_down (&start);
+  for (i = 0; i < ROUND_CNT; i++) 
+    {
+      rwlock_acquire_write (&rw);
+      value_a++;
+      thread_yield ();
+      value_b++;
+      rwlock_release_write (&rw);
+      thread_yield ();
+    }
+  sema_up (&done);
+}
+
+void
+test_rwlock_throughput (void) 
+{
+  int64_t start_time;
+  int i;
+
+  rwlock_init (&rw);
+  sema_init (&start, 0);
+  sema_init (&done, 0);
+  for (i = 0; i < READER_CNT; i++)
+    thread_create ("reader", PRI_DEFAULT, reader_thread, NULL);
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+
+  start_time = timer_ticks ();
+  for (i = 0; i < READER_CNT + 1; i++)
+    sema_up (&start);
+  for (i = 0; i < READER_CNT + 1; i++)
+    sema_down (&done);
+
+  msg ("%d readers, 1 writer: %d acquisitions in %"PRId64" ticks",
+       READER_CNT, (READER_CNT + 1) * ROUND_CNT, timer_elapsed (start_time));
+
+  if (torn)
+    fail ("a reader saw a write in progress");
+  if (max_readers_in < 2)
+    fail ("readers never held the lock at the same time");
+  if (value_a != ROUND_CNT || value_b != ROUND_CNT)
+    fail ("writer's updates were lost");
+  pass ();
+}
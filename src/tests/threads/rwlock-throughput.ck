@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+fail "missing timing\n"
+  if !grep (/^\(rwlock-throughput\) \d+ readers, 1 writer: \d+ acquisitions in \d+ ticks$/,
+            @output);
+fail "missing PASS\n" if !grep (/^\(rwlock-throughput\) PASS$/, @output);
+pass;
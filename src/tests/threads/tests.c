@@ -29,6 +29,10 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"palloc-bench", test_palloc_bench},
+    {"malloc-throughput", test_malloc_throughput},
+    {"rwlock-fairness", test_rwlock_fairness},
+    {"rwlock-throughput", test_rwlock_throughput},
   };
 
 static const char *test_name;
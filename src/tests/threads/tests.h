@@ -23,6 +23,10 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_palloc_bench;
+extern test_func test_malloc_throughput;
+extern test_func test_rwlock_fairness;
+extern test_func test_rwlock_throughput;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
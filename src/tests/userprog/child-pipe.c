@@ -0,0 +1,32 @@
+/* Child process run by pipe-exec test.
+   Reads its standard input, which it inherits from the parent,
+   to end of file and checks that it holds the sample data. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+
+int
+main (void) 
+{
+  char buf[sizeof sample];
+  int size = 0;
+
+  test_name = "child-pipe";
+  msg ("begin");
+  for (;;)
+    {
+      int bytes = read (STDIN_FILENO, buf + size, sizeof buf - size);
+      if (bytes < 0)
+        fail ("read failed");
+      if (bytes == 0)
+        break;
+      size += bytes;
+    }
+  if (size != sizeof sample - 1)
+    fail ("read %d bytes instead of %zu", size, sizeof sample - 1);
+  compare_bytes (buf, sample, size, 0, "stdin");
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,63 @@
+/* Copies between files with copy_file_range(): a multi-sector
+   copy between unaligned positions, a copy cut short because the
+   destination cannot grow, which must leave the source position
+   just past the bytes copied, and copies involving descriptors
+   that are not open files. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 3000
+
+static char pattern[SIZE];
+static char buf[SIZE];
+
+void
+test_main (void) 
+{
+  int src, dst, small, result;
+  size_t i;
+
+  for (i = 0; i < sizeof pattern; i++)
+    pattern[i] = i * 7 + i / 256;
+
+  CHECK (create ("src.dat", SIZE), "create \"src.dat\"");
+  CHECK ((src = open ("src.dat")) > 1, "open \"src.dat\"");
+  CHECK (write (src, pattern, SIZE) == SIZE, "write \"src.dat\"");
+  CHECK (create ("dst.dat", SIZE), "create \"dst.dat\"");
+  CHECK ((dst = open ("dst.dat")) > 1, "open \"dst.dat\"");
+
+  seek (src, 100);
+  seek (dst, 37);
+  result = copy_file_range (src, dst, 2500);
+  if (result != 2500)
+    fail ("copy_file_range() returned %d instead of 2500", result);
+  if (tell (src) != 2600 || tell (dst) != 2537)
+    fail ("positions are %u and %u instead of 2600 and 2537",
+          tell (src), tell (dst));
+  seek (dst, 37);
+  CHECK (read (dst, buf, 2500) == 2500, "read back \"dst.dat\"");
+  compare_bytes (buf, pattern + 100, 2500, 37, "dst.dat");
+
+  CHECK (create ("small.dat", 1000), "create \"small.dat\"");
+  CHECK ((small = open ("small.dat")) > 1, "open \"small.dat\"");
+  seek (src, 0);
+  result = copy_file_range (src, small, SIZE);
+  if (result != 1000)
+    fail ("copy_file_range() returned %d instead of 1000", result);
+  if (tell (src) != 1000)
+    fail ("source position is %u instead of 1000", tell (src));
+  CHECK (copy_file_range (src, small, SIZE) == 0,
+         "copy_file_range() at end of destination");
+  close (small);
+  check_file ("small.dat", pattern, 1000);
+
+  CHECK (copy_file_range (src, 1234, 10) == -1,
+         "copy_file_range() to bad fd");
+  CHECK (copy_file_range (STDIN_FILENO, dst, 10) == -1,
+         "copy_file_range() from console");
+  close (src);
+  close (dst);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) create "src.dat"
+(copy-range) open "src.dat"
+(copy-range) write "src.dat"
+(copy-range) create "dst.dat"
+(copy-range) open "dst.dat"
+(copy-range) read back "dst.dat"
+(copy-range) create "small.dat"
+(copy-range) open "small.dat"
+(copy-range) copy_file_range() at end of destination
+(copy-range) open "small.dat" for verification
+(copy-range) verified contents of "small.dat"
+(copy-range) close "small.dat"
+(copy-range) copy_file_range() to bad fd
+(copy-range) copy_file_range() from console
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
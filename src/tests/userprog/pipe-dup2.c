@@ -0,0 +1,44 @@
+/* Redirects the standard output into a pipe with dup2(), writes
+   to it, restores the original standard output from a saved
+   copy, and checks that the data arrived and that the console
+   still works, even after closing descriptor 1. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int fds[2];
+  int saved, redirected, restored, written;
+  char buf[16];
+
+  CHECK ((saved = dup (STDOUT_FILENO)) > STDOUT_FILENO, "dup() stdout");
+  CHECK (pipe (fds), "pipe()");
+
+  /* Nothing can be printed while the output is redirected. */
+  redirected = dup2 (fds[1], STDOUT_FILENO);
+  written = write (STDOUT_FILENO, "hello", 5);
+  restored = dup2 (saved, STDOUT_FILENO);
+  if (redirected != STDOUT_FILENO)
+    fail ("dup2() onto stdout returned %d", redirected);
+  if (written != 5)
+    fail ("write to redirected stdout returned %d", written);
+  if (restored != STDOUT_FILENO)
+    fail ("dup2() restoring stdout returned %d", restored);
+  msg ("redirected and restored stdout");
+  close (fds[1]);
+  close (saved);
+
+  CHECK (read (fds[0], buf, sizeof buf) == 5, "read from pipe");
+  if (memcmp (buf, "hello", 5))
+    fail ("data read from pipe differs from data written");
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read at end of file");
+  close (fds[0]);
+
+  close (STDOUT_FILENO);
+  msg ("closed stdout");
+}
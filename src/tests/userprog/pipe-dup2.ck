@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-dup2) begin
+(pipe-dup2) dup() stdout
+(pipe-dup2) pipe()
+(pipe-dup2) redirected and restored stdout
+(pipe-dup2) read from pipe
+(pipe-dup2) read at end of file
+(pipe-dup2) closed stdout
+(pipe-dup2) end
+pipe-dup2: exit(0)
+EOF
+pass;
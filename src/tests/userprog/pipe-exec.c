@@ -0,0 +1,23 @@
+/* Fills a pipe, makes its read end the standard input, and runs
+   a child that inherits it and reads the data back to end of
+   file. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int size = sizeof sample - 1;
+  int fds[2];
+
+  CHECK (pipe (fds), "pipe()");
+  CHECK (write (fds[1], sample, size) == size, "write sample to pipe");
+  close (fds[1]);
+  CHECK (dup2 (fds[0], STDIN_FILENO) == STDIN_FILENO, "dup2() onto stdin");
+  close (fds[0]);
+  msg ("wait(exec()) = %d", wait (exec ("child-pipe")));
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-exec) begin
+(pipe-exec) pipe()
+(pipe-exec) write sample to pipe
+(pipe-exec) dup2() onto stdin
+(child-pipe) begin
+(child-pipe) end
+child-pipe: exit(0)
+(pipe-exec) wait(exec()) = 0
+(pipe-exec) end
+pipe-exec: exit(0)
+EOF
+pass;
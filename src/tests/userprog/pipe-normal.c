@@ -0,0 +1,31 @@
+/* Writes to a pipe and reads the data back in the same process,
+   then checks end of file after the write end is closed and the
+   failure of a write after the read end is closed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  int fds[2];
+
+  CHECK (pipe (fds), "pipe()");
+  if (fds[0] < 2 || fds[1] < 2 || fds[0] == fds[1])
+    fail ("pipe() returned descriptors %d and %d", fds[0], fds[1]);
+  CHECK (write (fds[1], "hello", 5) == 5, "write to pipe");
+  CHECK (read (fds[0], buf, sizeof buf) == 5, "read from pipe");
+  if (memcmp (buf, "hello", 5))
+    fail ("read wrong data from pipe");
+  close (fds[1]);
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read at end of file");
+  close (fds[0]);
+
+  CHECK (pipe (fds), "pipe()");
+  close (fds[0]);
+  CHECK (write (fds[1], "hello", 5) == -1, "write with no reader");
+  close (fds[1]);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-normal) begin
+(pipe-normal) pipe()
+(pipe-normal) write to pipe
+(pipe-normal) read from pipe
+(pipe-normal) read at end of file
+(pipe-normal) pipe()
+(pipe-normal) write with no reader
+(pipe-normal) end
+pipe-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Reads and writes a file at explicit offsets with pread() and
+   pwrite(), out of order, and checks that neither moves the
+   file position. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  size_t half = size / 2;
+  char buf[32];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  byte_cnt = pread (handle, buf, sizeof buf, 20);
+  if (byte_cnt != sizeof buf)
+    fail ("pread() returned %d instead of %zu", byte_cnt, sizeof buf);
+  compare_bytes (buf, sample + 20, sizeof buf, 20, "sample.txt");
+  if (tell (handle) != 0)
+    fail ("pread() moved the file position to %u", tell (handle));
+  close (handle);
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  byte_cnt = pwrite (handle, sample + half, size - half, half);
+  if (byte_cnt != (int) (size - half))
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, size - half);
+  byte_cnt = pwrite (handle, sample, half, 0);
+  if (byte_cnt != (int) half)
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, half);
+  if (tell (handle) != 0)
+    fail ("pwrite() moved the file position to %u", tell (handle));
+  close (handle);
+
+  check_file ("test.txt", sample, size);
+}
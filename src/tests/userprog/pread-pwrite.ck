@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) open "sample.txt"
+(pread-pwrite) create "test.txt"
+(pread-pwrite) open "test.txt"
+(pread-pwrite) open "test.txt" for verification
+(pread-pwrite) verified contents of "test.txt"
+(pread-pwrite) close "test.txt"
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
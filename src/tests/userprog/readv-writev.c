@@ -0,0 +1,46 @@
+/* Writes a file from several buffers with one writev() call,
+   then reads it back into several buffers with one readv()
+   call, the last of which is only partly filled. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char a[50], b[100], c[300];
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = sample + 10;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = sample + 10;
+  iov[2].iov_len = size - 10;
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("writev() returned %d instead of %zu", byte_cnt, size);
+  close (handle);
+
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  iov[0].iov_base = a;
+  iov[0].iov_len = sizeof a;
+  iov[1].iov_base = b;
+  iov[1].iov_len = sizeof b;
+  iov[2].iov_base = c;
+  iov[2].iov_len = sizeof c;
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("readv() returned %d instead of %zu", byte_cnt, size);
+  compare_bytes (a, sample, sizeof a, 0, "test.txt");
+  compare_bytes (b, sample + sizeof a, sizeof b, sizeof a, "test.txt");
+  compare_bytes (c, sample + sizeof a + sizeof b, size - sizeof a - sizeof b,
+                 sizeof a + sizeof b, "test.txt");
+  close (handle);
+}
@@ -0,0 +1,76 @@
+/* Opens, reads, writes, and closes files through the system call
+   ring, several calls per ring_enter(), and checks each
+   completion. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct ring ring __attribute__ ((aligned (4096)));
+
+/* Queues a submission with the given fields. */
+static void
+submit (int opcode, int fd, void *buf, unsigned len, unsigned user_data)
+{
+  struct ring_sqe *sqe = &ring.sq[ring.sq_tail & RING_MASK];
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+/* Reaps the next completion, which must be for USER_DATA, and
+   returns its result. */
+static int
+reap (unsigned user_data)
+{
+  struct ring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("no completion for request %u", user_data);
+  cqe = &ring.cq[ring.cq_head++ & RING_MASK];
+  if (cqe->user_data != user_data)
+    fail ("completion for request %u instead of %u",
+          cqe->user_data, user_data);
+  return cqe->result;
+}
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char buf[sizeof sample];
+  int in, out, result;
+
+  CHECK (!ring_setup ((struct ring *) ((char *) &ring + 4)),
+         "ring_setup() rejects a misaligned ring");
+  CHECK (ring_setup (&ring), "ring_setup()");
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+
+  submit (RING_OP_OPEN, 0, "sample.txt", 0, 1);
+  submit (RING_OP_OPEN, 0, "test.txt", 0, 2);
+  CHECK (ring_enter (2) == 2, "submit two opens");
+  CHECK ((in = reap (1)) > 1, "open \"sample.txt\"");
+  CHECK ((out = reap (2)) > 1, "open \"test.txt\"");
+
+  submit (RING_OP_READ, in, buf, sizeof buf, 3);
+  submit (RING_OP_WRITE, out, (void *) sample, size, 4);
+  submit (RING_OP_CLOSE, in, NULL, 0, 5);
+  submit (RING_OP_CLOSE, out, NULL, 0, 6);
+  CHECK (ring_enter (RING_ENTRIES) == 4, "submit read, write, and closes");
+  if ((result = reap (3)) != (int) size)
+    fail ("read returned %d instead of %zu", result, size);
+  compare_bytes (buf, sample, size, 0, "sample.txt");
+  if ((result = reap (4)) != (int) size)
+    fail ("write returned %d instead of %zu", result, size);
+  reap (5);
+  reap (6);
+  if (ring.sq_head != ring.sq_tail)
+    fail ("%u submissions left over", ring.sq_tail - ring.sq_head);
+
+  check_file ("test.txt", sample, size);
+}
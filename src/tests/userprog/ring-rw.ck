@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-rw) begin
+(ring-rw) ring_setup() rejects a misaligned ring
+(ring-rw) ring_setup()
+(ring-rw) create "test.txt"
+(ring-rw) submit two opens
+(ring-rw) open "sample.txt"
+(ring-rw) open "test.txt"
+(ring-rw) submit read, write, and closes
+(ring-rw) open "test.txt" for verification
+(ring-rw) verified contents of "test.txt"
+(ring-rw) close "test.txt"
+(ring-rw) end
+ring-rw: exit(0)
+EOF
+pass;
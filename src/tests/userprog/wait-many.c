@@ -0,0 +1,32 @@
+/* Starts many child processes, letting them all exit before
+   waiting for any, then waits for them in the reverse order and
+   checks each exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 128
+
+void
+test_main (void) 
+{
+  pid_t pids[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pids[i] = exec ("child-simple");
+      if (pids[i] == PID_ERROR)
+        fail ("exec() of child %d failed", i);
+    }
+  for (i = CHILD_CNT - 1; i >= 0; i--)
+    {
+      int status = wait (pids[i]);
+      if (status != 81)
+        fail ("wait() for child %d returned %d", i, status);
+      if (wait (pids[i]) != -1)
+        fail ("second wait() for child %d succeeded", i);
+    }
+  msg ("waited for %d children", CHILD_CNT);
+}
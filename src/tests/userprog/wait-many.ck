@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($expected) = "(wait-many) begin\n"
+  . "(child-simple) run\n" x 128
+  . "(wait-many) waited for 128 children\n"
+  . "(wait-many) end\n";
+check_expected (IGNORE_EXIT_CODES => 1, [$expected]);
+pass;
@@ -22,15 +22,22 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/vmalloc.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
@@ -57,6 +64,14 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifdef VM
+/* -sl: Maximum number of pages a user stack may grow to. */
+static size_t stack_page_limit = 2048;
+
+/* -fa: Number of pages mapped around a faulting file page. */
+static size_t fault_around_pages = 8;
+#endif
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -98,6 +113,10 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  vmalloc_init ();
+#ifdef VM
+  page_init (stack_page_limit, fault_around_pages);
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -119,6 +138,9 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+#ifdef USERPROG
+  pagedir_init ();
+#endif
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -127,6 +149,12 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize swap and start the page-out daemon. */
+  swap_init ();
+  frame_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -259,6 +287,12 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-sl"))
+        stack_page_limit = atoi (value);
+      else if (!strcmp (name, "-fa"))
+        fault_around_pages = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -381,6 +415,10 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -sl=COUNT          Let user stacks grow to COUNT pages.\n"
+          "  -fa=COUNT          Map COUNT pages around a file page fault.\n"
 #endif
           );
   shutdown_power_off ();
@@ -5,17 +5,23 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "threads/vmalloc.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the next
+   "size class", a power of 2 or the size halfway between two
+   powers of 2 (16, 24, 32, 48, 64, ... bytes), and assigned to
+   the "descriptor" that manages blocks of that size.  The
+   in-between classes keep the space wasted by rounding under a
+   third of each block instead of under half.  The descriptor
+   keeps a list of free blocks.  If the free list is nonempty,
+   one of its blocks is used to satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
    obtained from the page allocator (if none is available,
@@ -28,19 +34,42 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
+   We can't handle blocks bigger than 1.5 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.  If the
+   kernel pool is too fragmented to have that many contiguous
+   pages, we fall back to vmalloc_get_multiple(), which maps
+   scattered pages at contiguous virtual addresses.
+
+   To keep most calls away from the descriptor lock, each thread
+   also has a "magazine" per descriptor: a short list of free
+   blocks that only it uses.  malloc() takes a block from the
+   running thread's magazine if it can, and free() puts the block
+   into it if there is room, both with interrupts disabled for
+   just a few instructions.  When the magazine is empty or full,
+   half a magazine's worth of blocks is moved from or to the
+   descriptor's free list at once, under the lock.  Blocks in a
+   magazine count as in use as far as their arena is concerned,
+   so an arena is only freed once all of its blocks are back on
+   the free list.  A thread's magazines are emptied when it
+   exits, and everybody's are emptied when the page allocator
+   runs short, so that threads that live long but allocate
+   rarely cannot keep arenas from being freed. */
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    size_t mag_size;            /* Capacity of a thread's magazine. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics, updated with interrupts off. */
+    long long alloc_cnt;        /* Number of allocations. */
+    long long requested_bytes;  /* Bytes asked for by those. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -54,18 +83,51 @@ struct arena
     size_t free_cnt;            /* Free blocks; pages in big block. */
   };
 
-/* Free block. */
+/* Free block.  A block in a magazine uses the first word of
+   FREE_ELEM to point to the next block in the magazine. */
 struct block 
   {
     struct list_elem free_elem; /* Free list element. */
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[MALLOC_CLASS_CNT]; /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics for big blocks, updated with interrupts off. */
+static long long big_alloc_cnt;         /* Number of big blocks. */
+static long long big_requested_bytes;   /* Bytes asked for. */
+static long long big_allocated_bytes;   /* Bytes in pages allocated. */
+
+/* Total bytes of blocks a magazine may hold, and the limits on
+   its capacity in blocks. */
+#define MAG_BYTES 2048
+#define MAG_MIN 2
+#define MAG_MAX 16
+
+/* Number of blocks in all threads' magazines.  Updated with
+   interrupts off. */
+static size_t mag_block_cnt;
+
+static size_t malloc_shrink_count (void);
+static size_t malloc_shrink_scan (size_t page_cnt);
+
+/* Empties magazines when the kernel pool runs short. */
+static struct shrinker malloc_shrinker =
+  {0, malloc_shrink_count, malloc_shrink_scan, {NULL, NULL}};
+
+static void init_desc (size_t block_size);
+static void count_alloc (struct desc *, size_t size);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *get_block (struct desc *);
+static bool put_block (struct desc *, struct block *);
+static struct block *mag_pop (struct malloc_magazine *);
+static void mag_push (struct malloc_magazine *, struct block *);
+static struct block *refill_magazine (struct desc *,
+                                      struct malloc_magazine *);
+static void drain_magazine (struct desc *, struct malloc_magazine *,
+                            size_t cnt);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -75,13 +137,49 @@ malloc_init (void)
 
   for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
     {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      init_desc (block_size);
+      init_desc (block_size + block_size / 2);
     }
+  palloc_register_shrinker (&malloc_shrinker);
+}
+
+/* Prints the number of bytes requested from and allocated by
+   each size class that has been used. */
+void
+malloc_print_stats (void) 
+{
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->alloc_cnt > 0)
+      printf ("Malloc: %4zu-byte blocks: %lld allocations, "
+              "%lld bytes requested, %lld allocated\n",
+              d->block_size, d->alloc_cnt, d->requested_bytes,
+              d->alloc_cnt * (long long) d->block_size);
+  if (big_alloc_cnt > 0)
+    printf ("Malloc: big blocks: %lld allocations, "
+            "%lld bytes requested, %lld allocated\n",
+            big_alloc_cnt, big_requested_bytes, big_allocated_bytes);
+}
+
+/* Sets up a descriptor for blocks of BLOCK_SIZE bytes. */
+static void
+init_desc (size_t block_size) 
+{
+  struct desc *d = &descs[desc_cnt++];
+
+  ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+  d->block_size = block_size;
+  d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+  d->mag_size = MAG_BYTES / block_size;
+  if (d->mag_size < MAG_MIN)
+    d->mag_size = MAG_MIN;
+  else if (d->mag_size > MAG_MAX)
+    d->mag_size = MAG_MAX;
+  list_init (&d->free_list);
+  lock_init (&d->lock);
+  d->alloc_cnt = 0;
+  d->requested_bytes = 0;
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -92,6 +190,8 @@ malloc (size_t size)
   struct desc *d;
   struct block *b;
   struct arena *a;
+  struct malloc_magazine *mag;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -108,6 +208,8 @@ malloc (size_t size)
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
       a = palloc_get_multiple (0, page_cnt);
+      if (a == NULL && page_cnt > 1)
+        a = vmalloc_get_multiple (0, page_cnt);
       if (a == NULL)
         return NULL;
 
@@ -116,40 +218,32 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
+
+      old_level = intr_disable ();
+      big_alloc_cnt++;
+      big_requested_bytes += size;
+      big_allocated_bytes += page_cnt * PGSIZE;
+      intr_set_level (old_level);
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* Take a block from the running thread's magazine, refilling
+     it from the descriptor if it is empty. */
+  mag = &thread_current ()->magazines[d - descs];
+  old_level = intr_disable ();
+  b = mag_pop (mag);
+  if (b != NULL)
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
+      d->alloc_cnt++;
+      d->requested_bytes += size;
+    }
+  intr_set_level (old_level);
+  if (b == NULL)
+    {
+      b = refill_magazine (d, mag);
+      if (b != NULL)
+        count_alloc (d, size);
     }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
   return b;
 }
 
@@ -227,42 +321,302 @@ free (void *p)
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          struct malloc_magazine *mag;
+          enum intr_level old_level;
+          bool stored = false;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
 
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* Put the block in the running thread's magazine.  If
+             the magazine is full, first give half of it back to
+             the descriptor. */
+          mag = &thread_current ()->magazines[d - descs];
+          old_level = intr_disable ();
+          if (mag->cnt < d->mag_size)
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              mag_push (mag, b);
+              stored = true;
+            }
+          intr_set_level (old_level);
+          if (!stored)
+            {
+              drain_magazine (d, mag, d->mag_size / 2);
+              old_level = intr_disable ();
+              mag_push (mag, b);
+              intr_set_level (old_level);
             }
-
-          lock_release (&d->lock);
         }
       else
         {
           /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
+          if (is_vmalloc_vaddr (a))
+            vmalloc_free_multiple (a, a->free_cnt);
+          else
+            palloc_free_multiple (a, a->free_cnt);
           return;
         }
     }
 }
 
+/* Records an allocation of SIZE bytes from descriptor D. */
+static void
+count_alloc (struct desc *d, size_t size) 
+{
+  enum intr_level old_level = intr_disable ();
+  d->alloc_cnt++;
+  d->requested_bytes += size;
+  intr_set_level (old_level);
+}
+
+/* Returns the blocks in the running thread's magazines to
+   their descriptors.  Called by thread_exit(). */
+void
+malloc_thread_exit (void) 
+{
+  struct thread *t = thread_current ();
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    drain_magazine (&descs[i], &t->magazines[i], t->magazines[i].cnt);
+}
+
+/* Removes a block from D's free list, creating a new arena if
+   the list is empty, and returns it.  Returns a null pointer if
+   memory is not available.  D's lock must be held.  It is
+   released while the arena's page is allocated, because the
+   shrinkers that the page allocator may have to wait for can
+   free blocks into D. */
+static struct block *
+get_block (struct desc *d) 
+{
+  struct block *b;
+  struct arena *a;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty (&d->free_list))
+    {
+      size_t i;
+
+      /* Allocate a page. */
+      lock_release (&d->lock);
+      a = palloc_get_page (0);
+      lock_acquire (&d->lock);
+      if (a == NULL) 
+        {
+          /* Someone else may have freed a block meanwhile. */
+          if (list_empty (&d->free_list))
+            return NULL; 
+        }
+      else
+        {
+          /* Initialize arena and add its blocks to the free
+             list. */
+          a->magic = ARENA_MAGIC;
+          a->desc = d;
+          a->free_cnt = d->blocks_per_arena;
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_push_back (&d->free_list, &b->free_elem);
+            }
+        }
+    }
+
+  /* Get a block from free list and return it. */
+  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+  a = block_to_arena (b);
+  a->free_cnt--;
+  return b;
+}
+
+/* Adds block B to D's free list, freeing B's arena if none of
+   its blocks is in use any longer.  Returns true if the arena
+   was freed.  D's lock must be held. */
+static bool
+put_block (struct desc *d, struct block *b) 
+{
+  struct arena *a = block_to_arena (b);
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+
+  /* If the arena is now entirely unused, free it. */
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      size_t i;
+
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_remove (&b->free_elem);
+        }
+      palloc_free_page (a);
+      return true;
+    }
+  return false;
+}
+
+/* Takes half a magazine's worth of blocks from descriptor D,
+   stores all but one of them in MAG, and returns the other one.
+   Returns a null pointer if memory is not available. */
+static struct block *
+refill_magazine (struct desc *d, struct malloc_magazine *mag) 
+{
+  struct block *first;
+  size_t i;
+
+  lock_acquire (&d->lock);
+  first = get_block (d);
+  for (i = 1; first != NULL && i < d->mag_size / 2; i++) 
+    {
+      struct block *b = get_block (d);
+      enum intr_level old_level;
+
+      if (b == NULL)
+        break;
+      old_level = intr_disable ();
+      mag_push (mag, b);
+      intr_set_level (old_level);
+    }
+  lock_release (&d->lock);
+  return first;
+}
+
+/* Returns CNT blocks from magazine MAG to descriptor D. */
+static void
+drain_magazine (struct desc *d, struct malloc_magazine *mag, size_t cnt) 
+{
+  struct block *chain = NULL;
+  enum intr_level old_level;
+
+  if (cnt == 0)
+    return;
+
+  /* Unlink the blocks from the magazine, keeping the links
+     between them, and then give them back all at once. */
+  old_level = intr_disable ();
+  ASSERT (cnt <= mag->cnt);
+  while (cnt-- > 0) 
+    {
+      struct block *b = mag_pop (mag);
+      b->free_elem.next = (struct list_elem *) chain;
+      chain = b;
+    }
+  intr_set_level (old_level);
+
+  lock_acquire (&d->lock);
+  while (chain != NULL) 
+    {
+      struct block *b = chain;
+      chain = (struct block *) b->free_elem.next;
+      put_block (d, b);
+    }
+  lock_release (&d->lock);
+}
+
+/* Removes and returns the first block in MAG, or returns a null
+   pointer if MAG is empty.  Interrupts must be off. */
+static struct block *
+mag_pop (struct malloc_magazine *mag) 
+{
+  struct block *b = mag->head;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (b != NULL)
+    {
+      mag->head = b->free_elem.next;
+      mag->cnt--;
+      mag_block_cnt--;
+    }
+  return b;
+}
+
+/* Adds B to the front of MAG.  Interrupts must be off. */
+static void
+mag_push (struct malloc_magazine *mag, struct block *b) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  b->free_elem.next = mag->head;
+  mag->head = b;
+  mag->cnt++;
+  mag_block_cnt++;
+}
+
+/* Returns the number of blocks in magazines, an upper bound on
+   the number of arenas that emptying them could free. */
+static size_t
+malloc_shrink_count (void) 
+{
+  return mag_block_cnt;
+}
+
+/* Moves the blocks in thread T's magazines onto the chains of
+   blocks in CHAINS_, one per descriptor, for thread_foreach(). */
+static void
+take_magazines (struct thread *t, void *chains_) 
+{
+  struct block **chains = chains_;
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++) 
+    {
+      struct block *b;
+
+      while ((b = mag_pop (&t->magazines[i])) != NULL) 
+        {
+          b->free_elem.next = (struct list_elem *) chains[i];
+          chains[i] = b;
+        }
+    }
+}
+
+/* Empties every thread's magazines, giving their blocks back to
+   their descriptors, and returns the number of arenas that
+   freed.  The magazines are taken all at once, whatever
+   PAGE_CNT is, because they cannot be told apart by how much
+   they would free; their owners refill them on demand. */
+static size_t
+malloc_shrink_scan (size_t page_cnt UNUSED) 
+{
+  struct block *chains[MALLOC_CLASS_CNT] = { NULL };
+  enum intr_level old_level;
+  size_t freed = 0;
+  size_t i;
+
+  old_level = intr_disable ();
+  thread_foreach (take_magazines, chains);
+  intr_set_level (old_level);
+
+  /* malloc() never calls the page allocator with a descriptor
+     lock held, so these locks cannot be ours. */
+  for (i = 0; i < desc_cnt; i++) 
+    if (chains[i] != NULL)
+      {
+        struct desc *d = &descs[i];
+
+        lock_acquire (&d->lock);
+        while (chains[i] != NULL) 
+          {
+            struct block *b = chains[i];
+            chains[i] = (struct block *) b->free_elem.next;
+            if (put_block (d, b))
+              freed++;
+          }
+        lock_release (&d->lock);
+      }
+  return freed;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
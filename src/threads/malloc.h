@@ -4,7 +4,20 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Number of malloc() size classes. */
+#define MALLOC_CLASS_CNT 14
+
+/* A thread's private stock of free malloc() blocks of one size
+   class.  See malloc.c. */
+struct malloc_magazine
+  {
+    void *head;                 /* First block; blocks are linked. */
+    unsigned cnt;               /* Number of blocks. */
+  };
+
 void malloc_init (void);
+void malloc_thread_exit (void);
+void malloc_print_stats (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
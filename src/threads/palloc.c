@@ -1,12 +1,13 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,22 +24,80 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, pages are managed by a binary buddy allocator.
+   Free memory is kept as blocks of 2**ORDER pages, each aligned
+   to its size relative to the start of the pool, on one free list
+   per order.  A request for N pages takes a block of the smallest
+   order that fits, splitting a larger block if necessary, and
+   returns the pages beyond N to the free lists.  Freeing a block
+   merges it with its "buddy", the other half of the block of the
+   next higher order, for as long as the buddy is free too.  Both
+   operations therefore take O(log n) time, instead of the linear
+   bitmap scan this allocator used to do.
+
+   Pages may be freed with interrupts off (see
+   thread_schedule_tail()), so the free lists are protected by
+   disabling interrupts rather than by a lock.  The critical
+   sections are short.
+
+   Each pool also keeps a small reserve of single pages that are
+   already zeroed.  The idle thread refills it, so that
+   palloc_get_page(PAL_ZERO), which is on the path of thread
+   creation, page directory creation and page faults, usually
+   does not have to clear a page itself.
+
+   When an allocation cannot be satisfied, the page allocator
+   asks the "shrinkers" that kernel caches have registered to
+   give memory back, and tries again, before it fails.  Caches
+   may therefore hold on to memory they do not strictly need for
+   as long as nobody else wants it. */
+
+/* Largest block order.  Blocks are at most 2**MAX_ORDER pages. */
+#define MAX_ORDER 10
+
+/* Value of a page's ORDER entry when it does not begin a free
+   block. */
+#define NOT_FREE 0xff
+
+/* Maximum number of pre-zeroed pages kept per pool. */
+#define ZERO_RESERVE 16
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *order;                     /* Per page: order of free block. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    size_t free_cnt;                    /* Number of free pages. */
+    struct list free_lists[MAX_ORDER + 1]; /* Free blocks by order. */
+    void *zeroed[ZERO_RESERVE];         /* Pre-zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pages in ZEROED. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Registered shrinkers. */
+static struct list shrinkers = LIST_INITIALIZER (shrinkers);
+
+/* Held while a thread runs the shrinkers. */
+static struct lock shrink_lock;
+
+/* Statistics. */
+static long long shrink_cnt;            /* # of calls to shrink(). */
+static long long shrunk_pages;          /* # of pages freed by it. */
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, unsigned order);
+static void *try_get_multiple (struct pool *, enum palloc_flags,
+                               size_t page_cnt);
+static bool shrink (struct pool *, enum palloc_flags, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -59,6 +118,7 @@ palloc_init (size_t user_page_limit)
   init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
   init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
              user_pages, "user pool");
+  lock_init (&shrink_lock);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -72,34 +132,58 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
-  size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  /* If memory is short, ask the shrinkers for some back, for as
+     long as they manage to free anything.  They may take locks,
+     so not from interrupt handlers or with interrupts off. */
+  pages = try_get_multiple (pool, flags, page_cnt);
+  while (pages == NULL && !intr_context () && intr_get_level () == INTR_ON
+         && shrink (pool, flags, page_cnt))
+    pages = try_get_multiple (pool, flags, page_cnt);
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+  if (pages == NULL && (flags & PAL_ASSERT))
+    PANIC ("palloc_get: out of pages");
+  return pages;
+}
+
+/* Tries to obtain PAGE_CNT contiguous pages from POOL, as
+   described for palloc_get_multiple().  Returns a null pointer
+   if too few pages are free. */
+static void *
+try_get_multiple (struct pool *pool, enum palloc_flags flags,
+                  size_t page_cnt)
+{
+  void *pages = NULL;
+  bool zeroed = false;
+  size_t page_idx;
+  enum intr_level old_level;
 
-  if (pages != NULL) 
+  /* Use a pre-zeroed page if the caller wants zeros, or if it is
+     the last page left. */
+  old_level = intr_disable ();
+  if (page_cnt == 1 && pool->zeroed_cnt > 0
+      && ((flags & PAL_ZERO) || pool->free_cnt == 0))
     {
-      if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
+      pages = pool->zeroed[--pool->zeroed_cnt];
+      zeroed = true;
     }
-  else 
+  else
     {
-      if (flags & PAL_ASSERT)
-        PANIC ("palloc_get: out of pages");
+      page_idx = alloc_pages (pool, page_cnt);
+      if (page_idx != SIZE_MAX)
+        pages = pool->base + PGSIZE * page_idx;
     }
+  intr_set_level (old_level);
 
+  if (pages != NULL && (flags & PAL_ZERO) && !zeroed)
+    memset (pages, 0, PGSIZE * page_cnt);
   return pages;
 }
 
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -119,6 +203,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -132,13 +217,15 @@ palloc_free_multiple (void *pages, size_t page_cnt)
     NOT_REACHED ();
 
   page_idx = pg_no (pages) - pg_no (pool->base);
+  ASSERT (page_idx + page_cnt <= pool->page_cnt);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  free_pages (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +235,156 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free pages in the user pool if PAL_USER
+   is set in FLAGS, otherwise in the kernel pool.  The count may
+   be stale by the time the caller looks at it. */
+size_t
+palloc_free_cnt (enum palloc_flags flags)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  return pool->free_cnt + pool->zeroed_cnt;
+}
+
+/* Zeroes one free page and adds it to the kernel or user pool's
+   reserve of pre-zeroed pages.  Returns false if neither reserve
+   has room or neither pool has a free page to spare.  Meant to
+   be called by the idle thread: it never blocks, and the page is
+   zeroed with interrupts on. */
+bool
+palloc_refill_zeroed (void)
+{
+  struct pool *pools[] = {&kernel_pool, &user_pool};
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+      struct pool *pool = pools[i];
+      enum intr_level old_level;
+      size_t page_idx = SIZE_MAX;
+      void *page;
+
+      /* Leave the pool's last few pages for real allocations. */
+      old_level = intr_disable ();
+      if (pool->zeroed_cnt < ZERO_RESERVE && pool->free_cnt > ZERO_RESERVE)
+        page_idx = alloc_pages (pool, 1);
+      intr_set_level (old_level);
+      if (page_idx == SIZE_MAX)
+        continue;
+
+      page = pool->base + PGSIZE * page_idx;
+      memset (page, 0, PGSIZE);
+
+      old_level = intr_disable ();
+      pool->zeroed[pool->zeroed_cnt++] = page;
+      intr_set_level (old_level);
+      return true;
+    }
+  return false;
+}
+
+/* Registers shrinker S.  Shrinkers are never unregistered. */
+void
+palloc_register_shrinker (struct shrinker *s) 
+{
+  enum intr_level old_level = intr_disable ();
+  list_push_back (&shrinkers, &s->elem);
+  intr_set_level (old_level);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  printf ("Palloc: %zu kernel and %zu user pages free, "
+          "%lld shrinks freed %lld pages\n",
+          palloc_free_cnt (0), palloc_free_cnt (PAL_USER),
+          shrink_cnt, shrunk_pages);
+}
+
+/* Tries to free PAGE_CNT pages in POOL, which is the pool FLAGS
+   selects: first by giving up the pool's pre-zeroed pages, then
+   by calling the shrinkers for the pool in the order they were
+   registered.  Returns true if any page was freed.
+
+   If another thread is already running the shrinkers, waits for
+   it to finish and returns true without running them again, so
+   that the caller retries its allocation with whatever that
+   thread freed.  If a shrinker itself allocates memory and runs
+   short, returns false at once instead of recursing.
+
+   Freeing PAGE_CNT pages does not guarantee that PAGE_CNT
+   contiguous pages are free, so the caller should simply try
+   again and call this again if it still fails. */
+static bool
+shrink (struct pool *pool, enum palloc_flags flags, size_t page_cnt)
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+  size_t freed = 0;
+
+  if (lock_held_by_current_thread (&shrink_lock))
+    return false;
+  if (!lock_try_acquire (&shrink_lock))
+    {
+      lock_acquire (&shrink_lock);
+      lock_release (&shrink_lock);
+      return true;
+    }
+
+  old_level = intr_disable ();
+  shrink_cnt++;
+
+  while (freed < page_cnt && pool->zeroed_cnt > 0)
+    {
+      void *page = pool->zeroed[--pool->zeroed_cnt];
+      free_pages (pool, pg_no (page) - pg_no (pool->base), 1);
+      freed++;
+    }
+  intr_set_level (old_level);
+
+  for (e = list_begin (&shrinkers); e != list_end (&shrinkers)
+         && freed < page_cnt; e = list_next (e))
+    {
+      struct shrinker *s = list_entry (e, struct shrinker, elem);
+
+      if ((s->flags & PAL_USER) == (flags & PAL_USER) && s->count () > 0)
+        freed += s->scan (page_cnt - freed);
+    }
+
+  old_level = intr_disable ();
+  shrunk_pages += freed;
+  intr_set_level (old_level);
+  lock_release (&shrink_lock);
+  return freed > 0;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's order map at its base.
+     Calculate the space needed for the map
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t map_pages = DIV_ROUND_UP (page_cnt, PGSIZE);
+  unsigned order;
+
+  if (map_pages > page_cnt)
+    PANIC ("Not enough memory in %s for order map.", name);
+  page_cnt -= map_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->order = base;
+  p->base = (uint8_t *) base + map_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  p->zeroed_cnt = 0;
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+  memset (p->order, NOT_FREE, page_cnt);
+  free_pages (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +394,112 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free-list element stored in the first page of the
+   free block at PAGE_IDX in POOL. */
+static struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the index of the page that holds free-list element E
+   in POOL. */
+static size_t
+elem_block (const struct pool *pool, struct list_elem *e)
+{
+  return ((uint8_t *) e - pool->base) / PGSIZE;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first one, or SIZE_MAX if no free block is large
+   enough.  Interrupts must be off. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt)
+{
+  unsigned want, order;
+  size_t page_idx;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+    if (want == MAX_ORDER)
+      return SIZE_MAX;
+
+  for (order = want; order <= MAX_ORDER; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order > MAX_ORDER)
+    return SIZE_MAX;
+
+  page_idx = elem_block (pool, list_pop_front (&pool->free_lists[order]));
+  ASSERT (pool->order[page_idx] == order);
+  pool->order[page_idx] = NOT_FREE;
+  pool->free_cnt -= (size_t) 1 << order;
+
+  /* Split the block until it is the size we want, freeing the
+     upper half each time. */
+  while (order > want)
+    {
+      order--;
+      free_block (pool, page_idx + ((size_t) 1 << order), order);
+    }
+
+  /* Give back the pages past PAGE_CNT. */
+  free_pages (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX in POOL to the
+   free lists, as the largest aligned blocks that cover them.
+   Interrupts must be off. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      unsigned order = 0;
+
+      while (order < MAX_ORDER
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Returns the block of 2**ORDER pages at PAGE_IDX in POOL to the
+   free lists, first merging it with its buddy for as long as the
+   buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, unsigned order)
+{
+  ASSERT (page_idx % ((size_t) 1 << order) == 0);
+  ASSERT (pool->order[page_idx] == NOT_FREE);
+
+  pool->free_cnt += (size_t) 1 << order;
+  while (order < MAX_ORDER)
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy_idx + ((size_t) 1 << order) > pool->page_cnt
+          || pool->order[buddy_idx] != order)
+        break;
+
+      list_remove (block_elem (pool, buddy_idx));
+      pool->order[buddy_idx] = NOT_FREE;
+      if (buddy_idx < page_idx)
+        page_idx = buddy_idx;
+      order++;
+    }
+
+  pool->order[page_idx] = order;
+  list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
+}
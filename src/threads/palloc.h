@@ -1,6 +1,8 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <list.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +13,25 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* A cache that can give memory back to the page allocator when
+   an allocation would otherwise fail. */
+struct shrinker
+  {
+    enum palloc_flags flags;    /* PAL_USER if it frees user pages. */
+    size_t (*count) (void);     /* Returns # of pages it could free. */
+    size_t (*scan) (size_t page_cnt); /* Frees up to PAGE_CNT pages,
+                                         returns # freed. */
+    struct list_elem elem;      /* Element in list of shrinkers. */
+  };
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+size_t palloc_free_cnt (enum palloc_flags);
+bool palloc_refill_zeroed (void);
+void palloc_register_shrinker (struct shrinker *);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
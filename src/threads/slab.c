@@ -0,0 +1,300 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Object caches.
+
+   malloc() rounds every request up to a power of two, so a
+   fixed-size kernel object that is a little bigger than a power
+   of two wastes almost half of its block.  An object cache
+   instead hands out objects of exactly one size, carved out of
+   one-page "slabs".
+
+   Each slab starts with a header that holds a stack of the
+   indexes of its free objects, followed by the objects
+   themselves.  A cache keeps its slabs that have both free and
+   allocated objects on one list and allocates from the front of
+   it, so that live objects stay packed into as few pages as
+   possible; full slabs are kept apart and are never searched.
+   Slabs that become empty are kept, not freed, so that a cache
+   that grows and shrinks does not keep calling the page
+   allocator.  Empty slabs are only given back when the page
+   allocator runs short of memory and calls our shrinker.
+
+   If a cache has a constructor, it is run on each object once,
+   when the object's slab is created, and objects must be in
+   their constructed state when they are freed.  Then whatever
+   the constructor sets up (say, a lock or a list) survives from
+   one use of the object to the next. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A slab. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's slab list. */
+    size_t free_cnt;            /* Number of entries in FREE. */
+    uint16_t free[];            /* Indexes of free objects. */
+  };
+
+/* All caches, for slab_print_stats(). */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static size_t slab_shrink_count (void);
+static size_t slab_shrink_scan (size_t page_cnt);
+
+/* Gives empty slabs back to the kernel pool under pressure. */
+static struct shrinker slab_shrinker =
+  {0, slab_shrink_count, slab_shrink_scan, {NULL, NULL}};
+
+static struct slab *slab_create (struct slab_cache *);
+static void *slab_object (struct slab *, size_t idx);
+
+/* Initializes C as a cache of OBJ_SIZE-byte objects named NAME.
+   If CTOR is nonnull, it is called on each object when its slab
+   is created.  No memory is allocated until the first call to
+   slab_alloc(), so this may be called early during boot. */
+void
+slab_cache_init (struct slab_cache *c, const char *name, size_t obj_size,
+                 slab_ctor_func *ctor)
+{
+  enum intr_level old_level;
+  size_t n;
+
+  ASSERT (obj_size > 0);
+
+  c->name = name;
+  c->obj_size = obj_size;
+  c->obj_stride = ROUND_UP (obj_size, sizeof (uint32_t));
+  c->ctor = ctor;
+
+  /* Fit as many objects into a page as possible, together with
+     their entries in the header's free stack. */
+  n = (PGSIZE - sizeof (struct slab)) / (c->obj_stride + sizeof (uint16_t));
+  while (n > 0
+         && (ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+                       sizeof (uint32_t))
+             + n * c->obj_stride) > PGSIZE)
+    n--;
+  ASSERT (n > 0);
+  c->objs_per_slab = n;
+  c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+                         sizeof (uint32_t));
+
+  lock_init (&c->lock);
+  list_init (&c->partial);
+  list_init (&c->full);
+  list_init (&c->empty);
+  c->empty_cnt = 0;
+
+  c->slab_cnt = 0;
+  c->in_use = 0;
+  c->peak_in_use = 0;
+  c->alloc_cnt = 0;
+
+  old_level = intr_disable ();
+  if (list_empty (&all_caches))
+    palloc_register_shrinker (&slab_shrinker);
+  list_push_back (&all_caches, &c->elem);
+  intr_set_level (old_level);
+}
+
+/* Allocates and returns an object from cache C, or returns a
+   null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else
+    {
+      /* Start a new slab, preferably an empty one we kept. */
+      if (!list_empty (&c->empty))
+        {
+          s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+          c->empty_cnt--;
+        }
+      else
+        {
+          s = slab_create (c);
+          if (s == NULL)
+            {
+              lock_release (&c->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  ASSERT (s->free_cnt > 0);
+  obj = slab_object (s, s->free[--s->free_cnt]);
+  if (s->free_cnt == 0)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+
+  c->alloc_cnt++;
+  if (++c->in_use > c->peak_in_use)
+    c->peak_in_use = c->in_use;
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  Does nothing if OBJ is null. */
+void
+slab_free (struct slab_cache *c, void *obj)
+{
+  struct slab *s;
+  size_t ofs;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+  ofs = pg_ofs (obj) - c->obj_ofs;
+  ASSERT (pg_ofs (obj) >= c->obj_ofs && ofs % c->obj_stride == 0);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it is supposed to stay constructed. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  ASSERT (s->free_cnt < c->objs_per_slab);
+  if (s->free_cnt == 0)
+    {
+      /* The slab was full and now has a free object. */
+      list_remove (&s->elem);
+      list_push_back (&c->partial, &s->elem);
+    }
+  s->free[s->free_cnt++] = ofs / c->obj_stride;
+  c->in_use--;
+
+  if (s->free_cnt == c->objs_per_slab)
+    {
+      /* The slab is now empty.  Keep it for later. */
+      list_remove (&s->elem);
+      list_push_front (&c->empty, &s->elem);
+      c->empty_cnt++;
+    }
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for each object cache. */
+void
+slab_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+      printf ("Slab %s: %zu-byte objects, %zu in use (peak %zu), "
+              "%zu slabs, %lld allocations\n",
+              c->name, c->obj_size, c->in_use, c->peak_in_use,
+              c->slab_cnt, c->alloc_cnt);
+    }
+}
+
+/* Returns the number of empty slabs in all caches. */
+static size_t
+slab_shrink_count (void)
+{
+  struct list_elem *e;
+  size_t cnt = 0;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    cnt += list_entry (e, struct slab_cache, elem)->empty_cnt;
+  return cnt;
+}
+
+/* Frees up to PAGE_CNT empty slabs and returns the number freed.
+   Caches whose lock is not free are skipped, since the page
+   allocator may have been called with one of them held. */
+static size_t
+slab_shrink_scan (size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t freed = 0;
+
+  for (e = list_begin (&all_caches);
+       e != list_end (&all_caches) && freed < page_cnt; e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+
+      /* lock_try_acquire() may not be called on a lock we hold,
+         which is the case when slab_create() for C is what ran
+         out of pages. */
+      if (lock_held_by_current_thread (&c->lock)
+          || !lock_try_acquire (&c->lock))
+        continue;
+      while (freed < page_cnt && !list_empty (&c->empty))
+        {
+          struct slab *s = list_entry (list_pop_front (&c->empty),
+                                       struct slab, elem);
+          c->empty_cnt--;
+          c->slab_cnt--;
+          s->magic = 0;
+          palloc_free_page (s);
+          freed++;
+        }
+      lock_release (&c->lock);
+    }
+  return freed;
+}
+
+/* Allocates a new slab for cache C and constructs its objects.
+   Returns the slab, or a null pointer if memory is not
+   available.  C's lock must be held. */
+static struct slab *
+slab_create (struct slab_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+
+  /* Hand out the lowest-addressed objects first. */
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      s->free[i] = c->objs_per_slab - i - 1;
+      if (c->ctor != NULL)
+        c->ctor (slab_object (s, i));
+    }
+  c->slab_cnt++;
+  return s;
+}
+
+/* Returns the object with index IDX in slab S. */
+static void *
+slab_object (struct slab *s, size_t idx)
+{
+  ASSERT (idx < s->cache->objs_per_slab);
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_stride;
+}
@@ -0,0 +1,40 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Constructor for the objects in a cache. */
+typedef void slab_ctor_func (void *obj);
+
+/* A cache of fixed-size objects.  See slab.c for details. */
+struct slab_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t obj_stride;          /* Distance between objects in a slab. */
+    size_t obj_ofs;             /* Offset of first object in a slab. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    slab_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Protects everything below. */
+    struct list partial;        /* Slabs with free and used objects. */
+    struct list full;           /* Slabs with no free objects. */
+    struct list empty;          /* Slabs with no used objects. */
+    size_t empty_cnt;           /* Number of slabs in EMPTY. */
+    struct list_elem elem;      /* Element in list of all caches. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Number of slabs. */
+    size_t in_use;              /* Number of allocated objects. */
+    size_t peak_in_use;         /* Maximum of IN_USE. */
+    long long alloc_cnt;        /* Number of allocations. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name,
+                      size_t obj_size, slab_ctor_func *);
+void *slab_alloc (struct slab_cache *) __attribute__ ((malloc));
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -251,8 +251,11 @@ struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    int priority;                       /* Priority of waiting thread. */
   };
 
+static void cond_signal_highest (struct condition *, struct lock *);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -295,6 +298,7 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
+  waiter.priority = thread_get_priority ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -336,3 +340,176 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Like cond_signal(), but wakes the waiter with the highest
+   priority, or the one that has waited longest among those with
+   equal priority. */
+static void
+cond_signal_highest (struct condition *cond, struct lock *lock UNUSED) 
+{
+  struct list_elem *e, *max = NULL;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
+
+  for (e = list_begin (&cond->waiters); e != list_end (&cond->waiters);
+       e = list_next (e))
+    if (max == NULL
+        || (list_entry (e, struct semaphore_elem, elem)->priority
+            > list_entry (max, struct semaphore_elem, elem)->priority))
+      max = e;
+
+  if (max != NULL)
+    {
+      list_remove (max);
+      sema_up (&list_entry (max, struct semaphore_elem, elem)->semaphore);
+    }
+}
+
+/* Initializes readers-writer lock RW. */
+void
+rwlock_init (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->can_read);
+  cond_init (&rw->can_write);
+  rw->reader_cnt = 0;
+  rw->writers_waiting = 0;
+  rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it or
+   is waiting for it.  The current thread must not already hold
+   RW for writing.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  while (rw->writer != NULL || rw->writers_waiting > 0)
+    cond_wait (&rw->can_read, &rw->lock);
+  rw->reader_cnt++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->reader_cnt > 0);
+  if (--rw->reader_cnt == 0)
+    cond_signal_highest (&rw->can_write, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  The current thread must not already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writers_waiting++;
+  while (rw->writer != NULL || rw->reader_cnt > 0)
+    cond_wait (&rw->can_write, &rw->lock);
+  rw->writers_waiting--;
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing.
+   The highest-priority waiting writer goes next if there is
+   one; otherwise all waiting readers are let in. */
+void
+rwlock_release_write (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writer = NULL;
+  if (rw->writers_waiting > 0)
+    cond_signal_highest (&rw->can_write, &rw->lock);
+  else
+    cond_broadcast (&rw->can_read, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Initializes sequence lock SL. */
+void
+seqlock_init (struct seqlock *sl) 
+{
+  ASSERT (sl != NULL);
+
+  sl->seq = 0;
+}
+
+/* Begins a read of the data protected by SL and returns the
+   sequence number to pass to seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *sl) 
+{
+  unsigned seq = *(const volatile unsigned *) &sl->seq;
+  barrier ();
+  return seq;
+}
+
+/* Returns true if the data read since seqlock_read_begin()
+   returned SEQ may be inconsistent because a write was in
+   progress or happened meanwhile, in which case the read must be
+   repeated. */
+bool
+seqlock_read_retry (const struct seqlock *sl, unsigned seq) 
+{
+  barrier ();
+  return (seq & 1) != 0 || *(const volatile unsigned *) &sl->seq != seq;
+}
+
+/* Begins a write of the data protected by SL. */
+void
+seqlock_write_begin (struct seqlock *sl) 
+{
+  ASSERT ((sl->seq & 1) == 0);
+
+  sl->seq++;
+  barrier ();
+}
+
+/* Ends a write of the data protected by SL. */
+void
+seqlock_write_end (struct seqlock *sl) 
+{
+  ASSERT ((sl->seq & 1) != 0);
+
+  barrier ();
+  sl->seq++;
+}
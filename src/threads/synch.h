@@ -41,6 +41,55 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock.  Any number of readers may hold it at
+   once, or a single writer.  Waiting writers take precedence
+   over new readers, so that a stream of readers cannot starve a
+   writer, and are let in highest priority first. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition can_read;  /* Signaled when readers may enter. */
+    struct condition can_write; /* Signaled when a writer may enter. */
+    unsigned reader_cnt;        /* # of threads with read access. */
+    unsigned writers_waiting;   /* # of threads waiting to write. */
+    struct thread *writer;      /* Thread with write access, or null. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Sequence lock, for small data that is read far more often
+   than it is written.  Readers never block or write shared
+   memory: they read the data between seqlock_read_begin() and
+   seqlock_read_retry() and start over if a write overlapped.
+
+       unsigned seq;
+       do
+         {
+           seq = seqlock_read_begin (&sl);
+           ...copy the data...
+         }
+       while (seqlock_read_retry (&sl, seq));
+
+   Writers must exclude each other by other means, and a writer
+   that can be interrupted by a reader (for example, a thread
+   writing data that an interrupt handler reads) must disable
+   interrupts, or the reader will retry forever. */
+struct seqlock
+  {
+    unsigned seq;               /* Odd while a write is in progress. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned seq);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
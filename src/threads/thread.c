@@ -8,6 +8,7 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -39,6 +40,27 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+#ifdef USERPROG
+/* Cache of `struct child_process'es. */
+struct slab_cache child_process_cache;
+#endif
+
+/* Pages of dead threads, kept for reuse by thread_create() so
+   that it need not go to the page allocator and zero a whole
+   page.  Protected by disabling interrupts, since pages are put
+   here from thread_schedule_tail(). */
+#define THREAD_CACHE_MAX 8
+static struct thread *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
+
+static size_t thread_cache_count (void);
+static size_t thread_cache_scan (size_t page_cnt);
+
+/* Gives cached thread pages back to the kernel pool under
+   pressure. */
+static struct shrinker thread_cache_shrinker =
+  {0, thread_cache_count, thread_cache_scan, {NULL, NULL}};
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -51,6 +73,8 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long created_cnt;   /* # of threads created. */
+static long long recycled_cnt;  /* # of those given a cached page. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
@@ -67,6 +91,8 @@ static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
+static struct thread *alloc_thread (void);
+static void free_thread (struct thread *);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
@@ -92,16 +118,19 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  lock_init (&file_lock);
+#ifdef USERPROG
+  slab_cache_init (&child_process_cache, "child_process",
+                   sizeof (struct child_process), NULL);
+#endif
   list_init (&ready_list);
   list_init (&all_list);
+  palloc_register_shrinker (&thread_cache_shrinker);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
-  list_init (&initial_thread->child_list);
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -149,6 +178,8 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld threads created, %lld on recycled pages\n",
+          created_cnt, recycled_cnt);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -179,7 +210,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -204,23 +235,6 @@ thread_create (const char *name, int priority,
   sf->eip = switch_entry;
   sf->ebp = 0;
 
-  struct thread *curr = thread_current ();
-
-  /* Add thread to current thread's child list */
-  list_init(&t->child_list);
-  struct child_process *cp = malloc(sizeof(struct child_process));
-  if (cp == NULL)
-    return TID_ERROR;
-  cp->parent = thread_current ();
-  sema_init (&cp->loading_sema, 0);
-  sema_init (&cp->waiting_sema, 0);
-  sema_init (&cp->start_sema, 0);
-  cp->load_status = LOADING;
-  cp->tid = tid;
-  cp->waited_on = false;
-  list_push_front (&curr->child_list, &cp->elem);
-  t->cp = cp;
-
   intr_set_level (old_level);
 
   /* Add to run queue. */
@@ -310,6 +324,7 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  malloc_thread_exit ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
@@ -423,6 +438,16 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else is runnable, so use the time to zero pages
+         for palloc_get_page(PAL_ZERO), until a thread wakes up.
+         If one did, block again instead of halting. */
+      intr_enable ();
+      while (list_empty (&ready_list) && palloc_refill_zeroed ())
+        continue;
+      intr_disable ();
+      if (!list_empty (&ready_list))
+        continue;
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -488,9 +513,15 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
-  t->fd_inc = 2;
+#ifdef USERPROG
+  t->fds = NULL;
+  t->fd_cnt = 0;
+  t->fd_hint = 0;
+  t->ring = NULL;
+  t->cp = NULL;
+  t->children_init = false;
   t->exec = NULL;
-  list_init (&t->open_files);
+#endif
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -566,8 +597,78 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      free_thread (prev);
+    }
+}
+
+/* Returns a page for a new thread, with its `struct thread'
+   zeroed, or a null pointer if none is available.  A recycled
+   page is preferred.  The rest of a recycled page, which will be
+   the thread's stack, is not cleared. */
+static struct thread *
+alloc_thread (void) 
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  created_cnt++;
+  if (thread_cache_cnt > 0)
+    {
+      t = thread_cache[--thread_cache_cnt];
+      recycled_cnt++;
+    }
+  intr_set_level (old_level);
+
+  if (t != NULL)
+    memset (t, 0, sizeof *t);
+  else
+    t = palloc_get_page (PAL_ZERO);
+  return t;
+}
+
+/* Releases T, a dead thread's page, keeping it for reuse if the
+   cache has room.  Interrupts must be off. */
+static void
+free_thread (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_cache_cnt < THREAD_CACHE_MAX)
+    thread_cache[thread_cache_cnt++] = t;
+  else
+    palloc_free_page (t);
+}
+
+/* Returns the number of cached thread pages. */
+static size_t
+thread_cache_count (void) 
+{
+  return thread_cache_cnt;
+}
+
+/* Frees up to PAGE_CNT cached thread pages and returns the
+   number freed. */
+static size_t
+thread_cache_scan (size_t page_cnt) 
+{
+  size_t freed = 0;
+
+  while (freed < page_cnt)
+    {
+      enum intr_level old_level = intr_disable ();
+      struct thread *t = NULL;
+
+      if (thread_cache_cnt > 0)
+        t = thread_cache[--thread_cache_cnt];
+      intr_set_level (old_level);
+      if (t == NULL)
+        break;
+
+      palloc_free_page (t);
+      freed++;
     }
+  return freed;
 }
 
 /* Schedules a new process.  At entry, interrupts must be off and
@@ -2,8 +2,11 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 
 /* Status of a process loading a user program */
@@ -34,22 +37,13 @@ typedef int tid_t;
 #define PRI_MAX 63                      /* Highest priority. */
 
 
-/* State information regarding a process's open file */
-struct process_file
-{
-    int fd;
-    struct file *file;
-    struct list_elem elem;
-};
-
-
 /* State information regarding a child thread/process */
 struct child_process
   {
     tid_t tid;                                 /* tid of the child process */
     struct thread *parent;                     /* Thread of the parent process */
-    struct list_elem elem;                     /* List element for child processes list. */
-    bool waited_on;                            /* Whether or not the process is being waited on by process_wait */
+    struct hash_elem elem;                     /* Element in the parent's children table. */
+    int ref_cnt;                               /* Parent and child each hold a reference */
     bool exited;                               /* Whether or not the process has exited due to a system call */
     int exit_status;                           /* The status of the process after exiting */
     struct semaphore waiting_sema;             /* Semaphore used when waiting on a child process with process_wait */
@@ -58,6 +52,9 @@ struct child_process
     enum userprog_loading_status load_status;  /* Whether or not the process failed to load the user program */
   };
 
+/* Cache that child_process records are allocated from. */
+extern struct slab_cache child_process_cache;
+
 
 /* A kernel thread or user process.
 
@@ -128,17 +125,28 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
-    struct list child_list;             /* List of child processes. */
+    /* Owned by malloc.c. */
+    struct malloc_magazine magazines[MALLOC_CLASS_CNT];
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                         /* Page directory. */
-    struct list open_files;                    /* List of all files open by the process     */
+    struct handle **fds;                       /* Open handles, indexed by file descriptor  */
+    int fd_cnt;                                /* Number of slots in fds                    */
+    int fd_hint;                               /* Every descriptor below this is in use     */
+    struct ring *ring;                         /* Registered system call ring, or null      */
     struct child_process *cp;                  /* A reference to child_process struct state */
-    int fd_inc;                                /* An incrementer for file descriptors       */
+    struct hash children;                      /* Child processes, keyed by tid             */
+    bool children_init;                        /* Has children been initialized?            */
     struct file *exec;                         /* Reference to the executable file running  */
 #endif
 
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash pages;                         /* Supplemental page table.                  */
+    void *user_esp;                            /* User %esp on entry to the kernel.         */
+#endif
+
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
@@ -0,0 +1,177 @@
+#include "threads/vmalloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/init.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Virtually contiguous kernel allocations.
+
+   palloc_get_multiple() needs physically contiguous pages, which
+   become hard to find once the kernel pool is fragmented, even
+   when there are plenty of free pages.  The functions here
+   instead take the pages one at a time from the kernel pool and
+   map them next to each other in a range of kernel virtual
+   addresses set aside for the purpose, above the mapping of
+   physical memory at PHYS_BASE.
+
+   The page tables for the whole range are created at boot and
+   installed in init_page_dir, which every process's page
+   directory copies, so a mapping made here is visible in every
+   address space at once.  One unmapped guard page is left after
+   each allocation to catch overruns.
+
+   Memory from here is not in the 1:1 physical mapping, so vtop()
+   must not be used on it. */
+
+/* Kernel virtual address range used for mappings. */
+#define VMALLOC_BASE ((uint8_t *) PHYS_BASE + 0x08000000)
+#define VMALLOC_PAGES 2048      /* 8 MB. */
+
+/* Page tables covering the range, in order. */
+#define PT_PAGES (PGSIZE / sizeof (uint32_t)) /* Pages mapped by a PT. */
+#define VMALLOC_PTS DIV_ROUND_UP (VMALLOC_PAGES, PT_PAGES)
+static uint32_t *page_tables[VMALLOC_PTS];
+
+static struct bitmap *used_map; /* One bit per page in the range. */
+static struct lock vmalloc_lock; /* Protects USED_MAP. */
+
+static void unmap_pages (uint8_t *pages, size_t page_cnt);
+static uint32_t *lookup_pte (const void *vaddr);
+
+/* Creates the page tables for the vmalloc range and installs
+   them in init_page_dir.  Must be called after paging_init() and
+   before any other page directory is created. */
+void
+vmalloc_init (void) 
+{
+  size_t i;
+
+  ASSERT (init_page_dir != NULL);
+  ASSERT (pt_no (VMALLOC_BASE) == 0);
+
+  for (i = 0; i < VMALLOC_PTS; i++)
+    {
+      uint8_t *vaddr = VMALLOC_BASE + i * PT_PAGES * PGSIZE;
+
+      ASSERT (init_page_dir[pd_no (vaddr)] == 0);
+      page_tables[i] = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+      init_page_dir[pd_no (vaddr)] = pde_create (page_tables[i]);
+    }
+
+  lock_init (&vmalloc_lock);
+  used_map = bitmap_create (VMALLOC_PAGES);
+  if (used_map == NULL)
+    PANIC ("vmalloc: can't allocate address map");
+}
+
+/* Obtains PAGE_CNT pages from the kernel pool, which need not be
+   physically contiguous, maps them at consecutive kernel virtual
+   addresses, and returns the first address.  PAL_ZERO and
+   PAL_ASSERT in FLAGS have the same meaning as for
+   palloc_get_multiple(); PAL_USER is not allowed.  Returns a
+   null pointer if memory or address space is not available. */
+void *
+vmalloc_get_multiple (enum palloc_flags flags, size_t page_cnt) 
+{
+  size_t start, i;
+  uint8_t *pages;
+
+  ASSERT ((flags & PAL_USER) == 0);
+
+  if (page_cnt == 0 || used_map == NULL)
+    goto fail;
+
+  /* Reserve addresses, with a guard page at the end. */
+  lock_acquire (&vmalloc_lock);
+  start = bitmap_scan_and_flip (used_map, 0, page_cnt + 1, false);
+  lock_release (&vmalloc_lock);
+  if (start == BITMAP_ERROR)
+    goto fail;
+  pages = VMALLOC_BASE + start * PGSIZE;
+
+  /* Back them with memory. */
+  for (i = 0; i < page_cnt; i++)
+    {
+      void *kpage = palloc_get_page (flags & PAL_ZERO);
+      if (kpage == NULL)
+        {
+          unmap_pages (pages, i);
+          lock_acquire (&vmalloc_lock);
+          bitmap_set_multiple (used_map, start, page_cnt + 1, false);
+          lock_release (&vmalloc_lock);
+          goto fail;
+        }
+      *lookup_pte (pages + i * PGSIZE) = pte_create_kernel (kpage, true);
+    }
+  return pages;
+
+ fail:
+  if (flags & PAL_ASSERT)
+    PANIC ("vmalloc_get: out of pages");
+  return NULL;
+}
+
+/* Unmaps and frees the PAGE_CNT pages starting at PAGES, which
+   must have been obtained from vmalloc_get_multiple(). */
+void
+vmalloc_free_multiple (void *pages, size_t page_cnt) 
+{
+  size_t start;
+
+  if (pages == NULL)
+    return;
+  ASSERT (is_vmalloc_vaddr (pages) && pg_ofs (pages) == 0);
+
+  unmap_pages (pages, page_cnt);
+
+  /* Release the addresses, including the guard page. */
+  start = pg_no (pages) - pg_no (VMALLOC_BASE);
+  lock_acquire (&vmalloc_lock);
+  ASSERT (bitmap_all (used_map, start, page_cnt + 1));
+  bitmap_set_multiple (used_map, start, page_cnt + 1, false);
+  lock_release (&vmalloc_lock);
+}
+
+/* Returns true if VADDR is in the vmalloc range. */
+bool
+is_vmalloc_vaddr (const void *vaddr) 
+{
+  const uint8_t *p = vaddr;
+  return p >= VMALLOC_BASE && p < VMALLOC_BASE + VMALLOC_PAGES * PGSIZE;
+}
+
+/* Unmaps the PAGE_CNT pages starting at PAGES and frees the
+   memory behind them. */
+static void
+unmap_pages (uint8_t *pages, size_t page_cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      uint8_t *vaddr = pages + i * PGSIZE;
+      uint32_t *pte = lookup_pte (vaddr);
+      void *kpage;
+
+      ASSERT (*pte & PTE_P);
+      kpage = pte_get_page (*pte);
+      *pte = 0;
+      asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+      palloc_free_page (kpage);
+    }
+}
+
+/* Returns the page table entry for VADDR in the vmalloc range. */
+static uint32_t *
+lookup_pte (const void *vaddr) 
+{
+  size_t page = pg_no (vaddr) - pg_no (VMALLOC_BASE);
+
+  ASSERT (is_vmalloc_vaddr (vaddr));
+  return &page_tables[page / PT_PAGES][pt_no (vaddr)];
+}
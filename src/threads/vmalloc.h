@@ -0,0 +1,13 @@
+#ifndef THREADS_VMALLOC_H
+#define THREADS_VMALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/palloc.h"
+
+void vmalloc_init (void);
+void *vmalloc_get_multiple (enum palloc_flags, size_t page_cnt);
+void vmalloc_free_multiple (void *, size_t page_cnt);
+bool is_vmalloc_vaddr (const void *);
+
+#endif /* threads/vmalloc.h */
@@ -2,8 +2,13 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -65,6 +70,10 @@ void
 exception_print_stats (void) 
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+  page_print_stats ();
+  frame_print_stats ();
+#endif
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -148,12 +157,28 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-   // Page fault in the kernel.
-  if (!user) {
-    f->eip = (void *) f->eax;  // Copy the former value of eip into eip.
-    f->eax = 0xffffffff;  // Set eax to 0xffffffff.
+#ifdef VM
+  /* Faults on pages the process owns but that are not yet backed
+     by a private frame are resolved here, whether the access
+     came from user code or from the kernel on its behalf. */
+  if (page_fault_resolve (fault_addr,
+                          user ? f->esp : thread_current ()->user_esp,
+                          not_present, write))
     return;
-  }
+#endif
+
+  /* A fault in the kernel at an instruction that accesses user
+     memory means the process passed a bad pointer: resume at the
+     instruction's fixup, which reports the error. */
+  if (!user)
+    {
+      void *fixup = search_exception_table (f->eip);
+      if (fixup != NULL)
+        {
+          f->eip = fixup;
+          return;
+        }
+    }
 
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
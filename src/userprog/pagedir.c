@@ -1,13 +1,91 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <list.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
 
+/* Range operations that span more pages than this flush the
+   whole TLB once instead of invalidating each page. */
+#define INVLPG_MAX 32
+
+/* Number of page directory entries that map user memory. */
+#define USER_PDES (LOADER_PHYS_BASE >> PDSHIFT)
+
+/* Summary of the user half of a page directory.  It records
+   which PDEs have page tables and how many present PTEs each one
+   holds, so that teardown only visits page tables that exist and
+   only scans those that still map something.
+
+   The summary is allocated separately from its page directory,
+   which keeps a pointer to it in PDE number SUMMARY_PDE.  That
+   entry would map the top 4 MB of virtual memory, which the
+   kernel never uses, and its present bit is clear, so the CPU
+   ignores it. */
+struct pd_summary
+  {
+    uint32_t *pd;                       /* The page directory. */
+    uint32_t populated[USER_PDES / 32]; /* Bitmap of PDEs with a PT. */
+    uint16_t present_cnt[USER_PDES];    /* Present PTEs in each PT. */
+    struct list_elem elem;              /* Element in teardown_list. */
+  };
+
+#define SUMMARY_PDE (PGSIZE / sizeof (uint32_t) - 1)
+
+/* Deferred teardown.
+
+   A process's page directory is not freed by the exiting thread
+   but queued on TEARDOWN_LIST for the "reclaim" thread, which
+   frees page tables in batches of TEARDOWN_BATCH, yielding the
+   CPU between batches.  If memory runs short before it gets
+   around to a page directory, the page allocator's shrinkers
+   tear it down on the spot.  All of this state is protected by
+   disabling interrupts. */
+#define TEARDOWN_BATCH 16
+static struct list teardown_list;       /* Queued page directories. */
+static struct semaphore teardown_sema;  /* Upped once per queued PD. */
+static bool teardown_started;           /* Is the reclaim thread up? */
+static size_t pending_kernel_pages;     /* Kernel pages in the queue. */
+static size_t pending_user_pages;       /* User pages in the queue. */
+
+static thread_func reclaim_thread NO_RETURN;
+static size_t reclaim_count_kernel (void);
+static size_t reclaim_count_user (void);
+static size_t reclaim_scan_kernel (size_t page_cnt);
+static size_t reclaim_scan_user (size_t page_cnt);
+
+static struct shrinker kernel_shrinker =
+  {0, reclaim_count_kernel, reclaim_scan_kernel, {NULL, NULL}};
+static struct shrinker user_shrinker =
+  {PAL_USER, reclaim_count_user, reclaim_scan_user, {NULL, NULL}};
+
+static struct pd_summary *summary (uint32_t *pd);
+static void count_pages (uint32_t *pd, size_t *kernel_cnt, size_t *user_cnt);
+static void teardown (uint32_t *pd, bool batch);
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+
+/* Starts the thread that tears down the page directories of
+   exited processes.  Until this is called, pagedir_destroy()
+   frees page directories immediately. */
+void
+pagedir_init (void) 
+{
+  list_init (&teardown_list);
+  sema_init (&teardown_sema, 0);
+  palloc_register_shrinker (&kernel_shrinker);
+  palloc_register_shrinker (&user_shrinker);
+  teardown_started = true;
+  thread_create ("reclaim", PRI_DEFAULT, reclaim_thread, NULL);
+}
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -17,36 +95,217 @@ uint32_t *
 pagedir_create (void) 
 {
   uint32_t *pd = palloc_get_page (0);
-  if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+  struct pd_summary *s;
+
+  if (pd == NULL)
+    return NULL;
+  s = calloc (1, sizeof *s);
+  if (s == NULL)
+    {
+      palloc_free_page (pd);
+      return NULL;
+    }
+
+  memcpy (pd, init_page_dir, PGSIZE);
+  ASSERT (pd[SUMMARY_PDE] == 0);
+  ASSERT (((uint32_t) s & PTE_P) == 0);
+  s->pd = pd;
+  pd[SUMMARY_PDE] = (uint32_t) s;
   return pd;
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references.  PD must not be active.  The memory is normally
+   freed later by the reclaim thread. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
-  uint32_t *pde;
+  enum intr_level old_level;
+  size_t kernel_cnt, user_cnt;
 
   if (pd == NULL)
     return;
 
   ASSERT (pd != init_page_dir);
-  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+  ASSERT (pd != active_pd ());
+  if (!teardown_started)
+    {
+      teardown (pd, false);
+      return;
+    }
+
+  count_pages (pd, &kernel_cnt, &user_cnt);
+  old_level = intr_disable ();
+  list_push_back (&teardown_list, &summary (pd)->elem);
+  pending_kernel_pages += kernel_cnt;
+  pending_user_pages += user_cnt;
+  intr_set_level (old_level);
+  sema_up (&teardown_sema);
+}
+
+/* Returns PD's summary. */
+static struct pd_summary *
+summary (uint32_t *pd) 
+{
+  return (struct pd_summary *) pd[SUMMARY_PDE];
+}
+
+/* Returns true if PDE number PDE_IDX in PD has a page table. */
+static inline bool
+is_populated (uint32_t *pd, size_t pde_idx) 
+{
+  return (summary (pd)->populated[pde_idx / 32] >> (pde_idx % 32)) & 1;
+}
+
+/* Stores into *KERNEL_CNT the number of kernel pages that
+   tearing down PD would free, and into *USER_CNT the number of
+   user pages. */
+static void
+count_pages (uint32_t *pd, size_t *kernel_cnt, size_t *user_cnt) 
+{
+  struct pd_summary *s = summary (pd);
+  size_t i;
+
+  *kernel_cnt = 2;                      /* PD and its summary. */
+  *user_cnt = 0;
+  for (i = 0; i < USER_PDES; i++)
+    if (is_populated (pd, i))
+      {
+        *kernel_cnt += 1;
+        *user_cnt += s->present_cnt[i];
+      }
+}
+
+/* Frees PD, its page tables, and the pages they map.  If BATCH
+   is true, yields the CPU after every TEARDOWN_BATCH page
+   tables. */
+static void
+teardown (uint32_t *pd, bool batch) 
+{
+  struct pd_summary *s = summary (pd);
+  size_t freed = 0;
+  size_t w;
+
+  for (w = 0; w < USER_PDES / 32; w++)
+    while (s->populated[w] != 0)
       {
-        uint32_t *pt = pde_get_pt (*pde);
-        uint32_t *pte;
-        
-        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-          if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+        size_t bit = __builtin_ctz (s->populated[w]);
+        size_t i = w * 32 + bit;
+        uint32_t *pt = pde_get_pt (pd[i]);
+
+        if (s->present_cnt[i] > 0)
+          {
+            uint32_t *pte;
+
+            for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
+              if (*pte & PTE_P) 
+                palloc_free_page (pte_get_page (*pte));
+          }
         palloc_free_page (pt);
+        s->populated[w] &= ~(1u << bit);
+
+        if (batch && ++freed % TEARDOWN_BATCH == 0)
+          thread_yield ();
       }
+  free (s);
   palloc_free_page (pd);
 }
 
+/* Removes and returns the page directory at the front of the
+   teardown queue, or returns a null pointer if it is empty.
+   Interrupts must be off. */
+static uint32_t *
+pop_pending (void) 
+{
+  struct pd_summary *s;
+  size_t kernel_cnt, user_cnt;
+  uint32_t *pd;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&teardown_list))
+    return NULL;
+  s = list_entry (list_pop_front (&teardown_list), struct pd_summary, elem);
+  pd = s->pd;
+  count_pages (pd, &kernel_cnt, &user_cnt);
+  pending_kernel_pages -= kernel_cnt;
+  pending_user_pages -= user_cnt;
+  return pd;
+}
+
+/* Reclaim thread.  Tears down queued page directories one at a
+   time, in batches. */
+static void
+reclaim_thread (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      uint32_t *pd;
+
+      sema_down (&teardown_sema);
+      old_level = intr_disable ();
+      pd = pop_pending ();
+      intr_set_level (old_level);
+
+      /* A shrinker may have beaten us to it. */
+      if (pd != NULL)
+        teardown (pd, true);
+    }
+}
+
+/* Tears down queued page directories until at least PAGE_CNT
+   pages have been freed into the kernel pool (if USER is false)
+   or the user pool (if USER is true), or the queue is empty.
+   Returns the number of pages freed into that pool. */
+static size_t
+reclaim_now (bool user, size_t page_cnt) 
+{
+  size_t freed = 0;
+
+  while (freed < page_cnt)
+    {
+      enum intr_level old_level;
+      size_t kernel_cnt, user_cnt;
+      uint32_t *pd;
+
+      old_level = intr_disable ();
+      pd = pop_pending ();
+      intr_set_level (old_level);
+      if (pd == NULL)
+        break;
+
+      count_pages (pd, &kernel_cnt, &user_cnt);
+      teardown (pd, false);
+      freed += user ? user_cnt : kernel_cnt;
+    }
+  return freed;
+}
+
+static size_t
+reclaim_count_kernel (void) 
+{
+  return pending_kernel_pages;
+}
+
+static size_t
+reclaim_count_user (void) 
+{
+  return pending_user_pages;
+}
+
+static size_t
+reclaim_scan_kernel (size_t page_cnt) 
+{
+  return reclaim_now (false, page_cnt);
+}
+
+static size_t
+reclaim_scan_user (size_t page_cnt) 
+{
+  return reclaim_now (true, page_cnt);
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -75,6 +334,8 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
             return NULL; 
       
           *pde = pde_create (pt);
+          summary (pd)->populated[pd_no (vaddr) / 32]
+            |= 1u << (pd_no (vaddr) % 32);
         }
       else
         return NULL;
@@ -112,6 +373,7 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     {
       ASSERT ((*pte & PTE_P) == 0);
       *pte = pte_create_user (kpage, writable);
+      summary (pd)->present_cnt[pd_no (upage)]++;
       return true;
     }
   else
@@ -152,8 +414,52 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      summary (pd)->present_cnt[pd_no (upage)]--;
+      invalidate_page (pd, upage);
+    }
+}
+
+/* Marks the PAGE_CNT user virtual pages starting at UPAGE "not
+   present" in page directory PD, as if by pagedir_clear_page()
+   on each one, but flushing the TLB at most once.  The pages
+   need not be mapped. */
+void
+pagedir_clear_range (uint32_t *pd, void *upage, size_t page_cnt)
+{
+  uint8_t *va = upage;
+  uint8_t *end = va + page_cnt * PGSIZE;
+  bool per_page = page_cnt <= INVLPG_MAX;
+  bool cleared = false;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (end >= va && end <= (uint8_t *) PHYS_BASE);
+
+  while (va < end)
+    {
+      uint32_t *pde = pd + pd_no (va);
+      uint32_t *pte;
+
+      /* Skip over page tables that do not exist or are empty. */
+      if ((*pde & PTE_P) == 0 || summary (pd)->present_cnt[pd_no (va)] == 0)
+        {
+          va = (uint8_t *) ((pd_no (va) + 1) << PDSHIFT);
+          continue;
+        }
+
+      pte = pde_get_pt (*pde) + pt_no (va);
+      if ((*pte & PTE_P) != 0)
+        {
+          *pte &= ~PTE_P;
+          summary (pd)->present_cnt[pd_no (va)]--;
+          if (per_page)
+            invalidate_page (pd, va);
+          cleared = true;
+        }
+      va += PGSIZE;
     }
+
+  if (!per_page && cleared)
+    invalidate_pagedir (pd);
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
@@ -180,11 +486,20 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
+/* Returns true if PD maps virtual page VPAGE present and
+   writable.  Returns false if PD contains no PTE for VPAGE. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *vpage) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_W)) == (PTE_P | PTE_W);
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD has been
    accessed recently, that is, between the time the PTE was
    installed and the last time it was cleared.  Returns false if
@@ -209,7 +524,7 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -230,6 +545,15 @@ pagedir_activate (uint32_t *pd)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
+/* Returns true if PD is the page directory loaded into the CPU.
+   A thread without a page directory of its own may be running
+   on another process's (see process_activate()). */
+bool
+pagedir_is_active (uint32_t *pd) 
+{
+  return active_pd () == pd;
+}
+
 /* Returns the currently active page directory. */
 static uint32_t *
 active_pd (void) 
@@ -261,3 +585,15 @@ invalidate_pagedir (uint32_t *pd)
       pagedir_activate (pd);
     } 
 }
+
+/* Invalidates the TLB entry for virtual address VADDR if PD is
+   the active page directory.  This is much cheaper than
+   invalidate_pagedir() when only one PTE has changed, because
+   the rest of the TLB survives.  See [IA32-v2a] "INVLPG--Invalidate
+   TLB Entry". */
+static void
+invalidate_page (uint32_t *pd, const void *vaddr)
+{
+  if (active_pd () == pd)
+    asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+}
@@ -0,0 +1,160 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* An anonymous pipe.
+
+   Data written to the write end is kept in a one-page ring
+   buffer until it is read from the read end.  A reader blocks
+   while the buffer is empty and the write end is open; once the
+   write end is closed, reads drain the buffer and then return 0
+   (end of file).  A writer blocks while the buffer is full and
+   the read end is open; writing after the read end is closed
+   fails.  The pipe is freed when both ends are closed. */
+struct pipe
+  {
+    struct lock lock;           /* Protects all the members. */
+    struct condition readable;  /* Signaled when data or EOF arrives. */
+    struct condition writable;  /* Signaled when room appears. */
+    uint8_t *buffer;            /* PIPE_SIZE bytes of ring buffer. */
+    size_t head;                /* Total bytes ever read. */
+    size_t tail;                /* Total bytes ever written. */
+    bool read_open;             /* Is the read end open? */
+    bool write_open;            /* Is the write end open? */
+  };
+
+#define PIPE_SIZE PGSIZE
+
+/* Creates and returns a new pipe with both ends open, or returns
+   a null pointer if memory is short. */
+struct pipe *
+pipe_create (void) 
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+
+  p->buffer = palloc_get_page (0);
+  if (p->buffer == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  cond_init (&p->readable);
+  cond_init (&p->writable);
+  p->head = p->tail = 0;
+  p->read_open = p->write_open = true;
+  return p;
+}
+
+/* Closes the write end of P if WRITER is true, otherwise its
+   read end, waking up anyone blocked on the other end.  Frees P
+   once both ends are closed. */
+void
+pipe_close (struct pipe *p, bool writer) 
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->write_open);
+      p->write_open = false;
+    }
+  else
+    {
+      ASSERT (p->read_open);
+      p->read_open = false;
+    }
+  cond_broadcast (&p->readable, &p->lock);
+  cond_broadcast (&p->writable, &p->lock);
+  dead = !p->read_open && !p->write_open;
+  lock_release (&p->lock);
+
+  if (dead)
+    {
+      palloc_free_page (p->buffer);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into BUFFER, waiting until at
+   least one byte is available or the write end is closed.
+   Returns the number of bytes read, which is 0 at end of file. */
+int
+pipe_read (struct pipe *p, void *buffer_, size_t size) 
+{
+  uint8_t *buffer = buffer_;
+  size_t bytes_read = 0;
+
+  if (size == 0)
+    return 0;
+
+  lock_acquire (&p->lock);
+  while (p->head == p->tail && p->write_open)
+    cond_wait (&p->readable, &p->lock);
+
+  while (bytes_read < size && p->head != p->tail)
+    {
+      size_t ofs = p->head % PIPE_SIZE;
+      size_t chunk = p->tail - p->head;
+
+      /* Copy at most up to the end of the ring. */
+      if (chunk > PIPE_SIZE - ofs)
+        chunk = PIPE_SIZE - ofs;
+      if (chunk > size - bytes_read)
+        chunk = size - bytes_read;
+      memcpy (buffer + bytes_read, p->buffer + ofs, chunk);
+      p->head += chunk;
+      bytes_read += chunk;
+    }
+  cond_broadcast (&p->writable, &p->lock);
+  lock_release (&p->lock);
+
+  return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into P, waiting for room as
+   necessary.  Returns the number of bytes written, which is less
+   than SIZE only if the read end is closed partway through, or
+   -1 if it was closed before anything was written. */
+int
+pipe_write (struct pipe *p, const void *buffer_, size_t size) 
+{
+  const uint8_t *buffer = buffer_;
+  size_t bytes_written = 0;
+
+  lock_acquire (&p->lock);
+  while (bytes_written < size && p->read_open)
+    {
+      size_t ofs = p->tail % PIPE_SIZE;
+      size_t chunk = PIPE_SIZE - (p->tail - p->head);
+
+      if (chunk == 0)
+        {
+          cond_wait (&p->writable, &p->lock);
+          continue;
+        }
+
+      /* Copy at most up to the end of the ring. */
+      if (chunk > PIPE_SIZE - ofs)
+        chunk = PIPE_SIZE - ofs;
+      if (chunk > size - bytes_written)
+        chunk = size - bytes_written;
+      memcpy (p->buffer + ofs, buffer + bytes_written, chunk);
+      p->tail += chunk;
+      bytes_written += chunk;
+      cond_broadcast (&p->readable, &p->lock);
+    }
+  lock_release (&p->lock);
+
+  if (bytes_written == 0 && size > 0)
+    return -1;
+  return bytes_written;
+}
@@ -1 +1 @@
-#include "userprog/process.h"#include <debug.h>#include <inttypes.h>#include <round.h>#include <stdio.h>#include "devices/timer.h"#include "threads/malloc.h"#include <stdlib.h>#include <string.h>#include "userprog/gdt.h"#include "userprog/pagedir.h"#include "userprog/tss.h"#include "userprog/syscall.h"#include "filesys/directory.h"#include "filesys/file.h"#include "filesys/filesys.h"#include "threads/flags.h"#include "threads/init.h"#include "threads/interrupt.h"#include "threads/palloc.h"#include "threads/thread.h"#include "threads/vaddr.h"#include "process.h"static thread_func start_process NO_RETURN;static bool load (const char *cmdline, void (**eip) (void), void **esp);/* Starts a new thread running a user program loaded from   FILENAME.  The new thread may be scheduled (and may even exit)   before process_execute() returns.  Returns the new process's   thread id, or TID_ERROR if the thread cannot be created. */tid_tprocess_execute (const char *file_name) {  char *fn_copy;  tid_t tid;  /* Make a copy of FILE_NAME.     Otherwise there's a race between the caller and load(). */  fn_copy = palloc_get_page (0);  if (fn_copy == NULL)     return TID_ERROR;  strlcpy (fn_copy, file_name, PGSIZE);  char *temp;  char *full = palloc_get_page (0);  if (full == NULL) {    palloc_free_page (fn_copy);     return TID_ERROR;  }  strlcpy (full, file_name, PGSIZE);  fn_copy = strtok_r( (char *)fn_copy, " ", &temp );  /* Create a new thread to execute FILE_NAME. */  tid = thread_create (fn_copy, PRI_DEFAULT, start_process, full);  if (tid == TID_ERROR)  {    palloc_free_page (fn_copy);     palloc_free_page (full);     return tid;  }  struct child_process *cp = get_child_process (tid);  sema_down (&cp->start_sema);  if (cp->load_status != LOAD_SUCCESS)   {    palloc_free_page (fn_copy);    return TID_ERROR;   }  return tid;}/* A thread function that loads a user process and starts it   running. */static voidstart_process (void *file_name_){  char *file_name = file_name_;  struct intr_frame if_;  bool success;  /* Initialize interrupt frame and load executable. */  memset (&if_, 0, sizeof if_);  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;  if_.cs = SEL_UCSEG;  if_.eflags = FLAG_IF | FLAG_MBS;  success = load (file_name, &if_.eip, &if_.esp);  if (!success)    thread_current()->cp->load_status = LOAD_FAILED;  else    thread_current()->cp->load_status = LOAD_SUCCESS;  // Ensure synchronization with parent  sema_up (&thread_current()->cp->loading_sema);  /* If load failed, quit. */  palloc_free_page (file_name);  sema_up (&thread_current()->cp->start_sema);  if (!success)     thread_exit ();  /* Start the user process by simulating a return from an     interrupt, implemented by intr_exit (in     threads/intr-stubs.S).  Because intr_exit takes all of its     arguments on the stack in the form of a `struct intr_frame',     we just point the stack pointer (%esp) to our stack frame     and jump to it. */  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");  NOT_REACHED ();}struct child_process* get_child_process (tid_t child_tid){  struct thread *t = thread_current();  struct list_elem *next;  for (struct list_elem *e = list_begin(&t->child_list); e != list_end(&t->child_list); e = next)  {    next = list_next(e);    struct child_process *child = list_entry(e, struct child_process, elem);    if (child_tid == child->tid)    {      return child;    }  }  return NULL;}/* Waits for thread TID to die and returns its exit status.  If   it was terminated by the kernel (i.e. killed due to an   exception), returns -1.  If TID is invalid or if it was not a   child of the calling process, or if process_wait() has already   been successfully called for the given TID, returns -1   immediately, without waiting.   This function will be implemented in problem 2-2.  For now, it   does nothing. */intprocess_wait (tid_t child_tid) {  struct child_process *t = get_child_process (child_tid);  if (!t || child_tid < 0 || t->waited_on) return -1;  t->waited_on = true;  sema_down (&t->waiting_sema);  int status = t->exit_status;  list_remove(&t->elem);  free(t);  return status;}/* Free the current process's resources. */voidprocess_exit (void){  struct thread *cur = thread_current ();  uint32_t *pd;    /* Close all file descriptors */  struct list_elem *next;  for (struct list_elem *e = list_begin(&cur->open_files); e != list_end(&cur->open_files); e = next)  {    next = list_next(e);    struct process_file *pf = list_entry (e, struct process_file, elem);    close (pf->fd);  }  lock_acquire (&file_lock);  // Finally close the file  if (cur->exec)     file_close(cur->exec);    lock_release (&file_lock);  /* Destroy the current process's page directory and switch back     to the kernel-only page directory. */  pd = cur->pagedir;  if (pd != NULL)     {      /* Correct ordering here is crucial.  We must set         cur->pagedir to NULL before switching page directories,         so that a timer interrupt can't switch back to the         process page directory.  We must activate the base page         directory before destroying the process's page         directory, or our active page directory will be one         that's been freed (and cleared). */      cur->pagedir = NULL;      pagedir_activate (NULL);      pagedir_destroy (pd);    }}/* Sets up the CPU for running user code in the current   thread.   This function is called on every context switch. */voidprocess_activate (void){  struct thread *t = thread_current ();  /* Activate thread's page tables. */  pagedir_activate (t->pagedir);  /* Set thread's kernel stack for use in processing     interrupts. */  tss_update ();}/* We load ELF binaries.  The following definitions are taken   from the ELF specification, [ELF1], more-or-less verbatim.  *//* ELF types.  See [ELF1] 1-2. */typedef uint32_t Elf32_Word, Elf32_Addr, Elf32_Off;typedef uint16_t Elf32_Half;/* For use with ELF types in printf(). */#define PE32Wx PRIx32   /* Print Elf32_Word in hexadecimal. */#define PE32Ax PRIx32   /* Print Elf32_Addr in hexadecimal. */#define PE32Ox PRIx32   /* Print Elf32_Off in hexadecimal. */#define PE32Hx PRIx16   /* Print Elf32_Half in hexadecimal. *//* Executable header.  See [ELF1] 1-4 to 1-8.   This appears at the very beginning of an ELF binary. */struct Elf32_Ehdr  {    unsigned char e_ident[16];    Elf32_Half    e_type;    Elf32_Half    e_machine;    Elf32_Word    e_version;    Elf32_Addr    e_entry;    Elf32_Off     e_phoff;    Elf32_Off     e_shoff;    Elf32_Word    e_flags;    Elf32_Half    e_ehsize;    Elf32_Half    e_phentsize;    Elf32_Half    e_phnum;    Elf32_Half    e_shentsize;    Elf32_Half    e_shnum;    Elf32_Half    e_shstrndx;  };/* Program header.  See [ELF1] 2-2 to 2-4.   There are e_phnum of these, starting at file offset e_phoff   (see [ELF1] 1-6). */struct Elf32_Phdr  {    Elf32_Word p_type;    Elf32_Off  p_offset;    Elf32_Addr p_vaddr;    Elf32_Addr p_paddr;    Elf32_Word p_filesz;    Elf32_Word p_memsz;    Elf32_Word p_flags;    Elf32_Word p_align;  };/* Values for p_type.  See [ELF1] 2-3. */#define PT_NULL    0            /* Ignore. */#define PT_LOAD    1            /* Loadable segment. */#define PT_DYNAMIC 2            /* Dynamic linking info. */#define PT_INTERP  3            /* Name of dynamic loader. */#define PT_NOTE    4            /* Auxiliary info. */#define PT_SHLIB   5            /* Reserved. */#define PT_PHDR    6            /* Program header table. */#define PT_STACK   0x6474e551   /* Stack segment. *//* Flags for p_flags.  See [ELF3] 2-3 and 2-4. */#define PF_X 1          /* Executable. */#define PF_W 2          /* Writable. */#define PF_R 4          /* Readable. */static bool setup_stack (void **esp, char **args, int argc);static bool validate_segment (const struct Elf32_Phdr *, struct file *);static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,                          uint32_t read_bytes, uint32_t zero_bytes,                          bool writable);/* Loads an ELF executable from FILE_NAME into the current thread.   Stores the executable's entry point into *EIP   and its initial stack pointer into *ESP.   Returns true if successful, false otherwise. */boolload (const char *file_name, void (**eip) (void), void **esp) {  struct thread *t = thread_current ();  struct Elf32_Ehdr ehdr;  struct file *file = NULL;  off_t file_ofs;  bool success = false;  int i;  /* Allocate and activate page directory. */  t->pagedir = pagedir_create ();  if (t->pagedir == NULL)   {    goto done;  }  process_activate ();  /* Parse the filename into it's arguments for setting up the stack */  char *file_name_cpy = (char *)malloc(strlen(file_name)+1);  if (file_name_cpy == NULL)    goto done;  strlcpy(file_name_cpy, file_name, strlen(file_name)+1);  // Deal with multiple spaces  char* temp = NULL;  while ((temp = strstr(file_name_cpy, "  ")) != NULL)    memmove(temp, temp + 1, strlen(temp));  // Trim trailing spaces  int index = -1;  i = 0;  while(file_name_cpy[i] != '\0')  {      if(file_name_cpy[i] != ' ' && file_name_cpy[i] != '\t' && file_name_cpy[i] != '\n')      {          index= i;      }      i++;  }  file_name_cpy[index + 1] = '\0';  int count;  for (i=0, count=0; file_name_cpy[i]; i++)    count += (file_name_cpy[i] == ' ');  char **args = (char **)malloc((count+1) * sizeof(char *));  if (args == NULL)   {    free(file_name_cpy);    goto done;  }  char *rest = file_name_cpy;  char *tk = strtok_r(file_name_cpy, " ", &rest);  i = 0;  while (tk != NULL)  {    args[i] = malloc (strlen(tk) + 1);    if (args[i] == NULL)     {      goto done;    }    memcpy(args[i], tk, strlen(tk) + 1);    tk = strtok_r(rest, " \t\n", &rest);    i++;  }  // NULL sentinel   args[i] = NULL;  free(file_name_cpy);  lock_acquire (&file_lock);  /* Open executable file. */  file = filesys_open (args[0]);  if (file == NULL)     {      printf ("load: %s: open failed\n", args[0]);      goto done;     }  // Deny writes to executables  file_deny_write (file);  t->exec = file;  /* Read and verify executable header. */  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr      || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)      || ehdr.e_type != 2      || ehdr.e_machine != 3      || ehdr.e_version != 1      || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)      || ehdr.e_phnum > 1024)     {      printf ("load: %s: error loading executable\n", args[0]);      goto done;     }  /* Read program headers. */  file_ofs = ehdr.e_phoff;  for (i = 0; i < ehdr.e_phnum; i++)     {      struct Elf32_Phdr phdr;      if (file_ofs < 0 || file_ofs > file_length (file))      {        goto done;      }      file_seek (file, file_ofs);      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)      {        goto done;      }      file_ofs += sizeof phdr;      switch (phdr.p_type)         {        case PT_NULL:        case PT_NOTE:        case PT_PHDR:        case PT_STACK:        default:          /* Ignore this segment. */          break;        case PT_DYNAMIC:        case PT_INTERP:        case PT_SHLIB:          goto done;        case PT_LOAD:          if (validate_segment (&phdr, file))             {              bool writable = (phdr.p_flags & PF_W) != 0;              uint32_t file_page = phdr.p_offset & ~PGMASK;              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;              uint32_t page_offset = phdr.p_vaddr & PGMASK;              uint32_t read_bytes, zero_bytes;              if (phdr.p_filesz > 0)                {                  /* Normal segment.                     Read initial part from disk and zero the rest. */                  read_bytes = page_offset + phdr.p_filesz;                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)                                - read_bytes);                }              else                 {                  /* Entirely zero.                     Don't read anything from disk. */                  read_bytes = 0;                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);                }              if (!load_segment (file, file_page, (void *) mem_page,                                 read_bytes, zero_bytes, writable))              {                goto done;              }            }          else          {            goto done;          }          break;        }    }  /* Set up stack. */  if (!setup_stack (esp, args, count))  {    goto done;  }  /* Start address. */  *eip = (void (*) (void)) ehdr.e_entry;  success = true; done:  /* We arrive here whether the load is successful or not. */  lock_release (&file_lock);  //file_close (file);  return success;}/* load() helpers. */static bool install_page (void *upage, void *kpage, bool writable);/* Checks whether PHDR describes a valid, loadable segment in   FILE and returns true if so, false otherwise. */static boolvalidate_segment (const struct Elf32_Phdr *phdr, struct file *file) {  /* p_offset and p_vaddr must have the same page offset. */  if ((phdr->p_offset & PGMASK) != (phdr->p_vaddr & PGMASK))     return false;   /* p_offset must point within FILE. */  if (phdr->p_offset > (Elf32_Off) file_length (file))     return false;  /* p_memsz must be at least as big as p_filesz. */  if (phdr->p_memsz < phdr->p_filesz)     return false;   /* The segment must not be empty. */  if (phdr->p_memsz == 0)    return false;    /* The virtual memory region must both start and end within the     user address space range. */  if (!is_user_vaddr ((void *) phdr->p_vaddr))    return false;  if (!is_user_vaddr ((void *) (phdr->p_vaddr + phdr->p_memsz)))    return false;  /* The region cannot "wrap around" across the kernel virtual     address space. */  if (phdr->p_vaddr + phdr->p_memsz < phdr->p_vaddr)    return false;  /* Disallow mapping page 0.     Not only is it a bad idea to map page 0, but if we allowed     it then user code that passed a null pointer to system calls     could quite likely panic the kernel by way of null pointer     assertions in memcpy(), etc. */  if (phdr->p_vaddr < PGSIZE)    return false;  /* It's okay. */  return true;}/* Loads a segment starting at offset OFS in FILE at address   UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual   memory are initialized, as follows:        - READ_BYTES bytes at UPAGE must be read from FILE          starting at offset OFS.        - ZERO_BYTES bytes at UPAGE + READ_BYTES must be zeroed.   The pages initialized by this function must be writable by the   user process if WRITABLE is true, read-only otherwise.   Return true if successful, false if a memory allocation error   or disk read error occurs. */static boolload_segment (struct file *file, off_t ofs, uint8_t *upage,              uint32_t read_bytes, uint32_t zero_bytes, bool writable) {  ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);  ASSERT (pg_ofs (upage) == 0);  ASSERT (ofs % PGSIZE == 0);  file_seek (file, ofs);  while (read_bytes > 0 || zero_bytes > 0)     {      /* Calculate how to fill this page.         We will read PAGE_READ_BYTES bytes from FILE         and zero the final PAGE_ZERO_BYTES bytes. */      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;      size_t page_zero_bytes = PGSIZE - page_read_bytes;      /* Get a page of memory. */      uint8_t *kpage = palloc_get_page (PAL_USER);      if (kpage == NULL)        return false;      /* Load this page. */      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)        {          palloc_free_page (kpage);          return false;         }      memset (kpage + page_read_bytes, 0, page_zero_bytes);      /* Add the page to the process's address space. */      if (!install_page (upage, kpage, writable))         {          palloc_free_page (kpage);          return false;         }      /* Advance. */      read_bytes -= page_read_bytes;      zero_bytes -= page_zero_bytes;      upage += PGSIZE;    }  return true;}/* Create a minimal stack by mapping a zeroed page at the top of   user virtual memory. */static boolsetup_stack (void **esp, char **args, int argc) {  uint32_t *temp;  uint8_t *kpage;  bool success = false;  kpage = palloc_get_page (PAL_USER | PAL_ZERO);  if (kpage != NULL)     {      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);      if (success) {        void *argAddress[argc];        int off = 0;        int i;        // Push the arguments (strings) to the stack        for (i = 0; args[i] != NULL; i++) {          off += strlen(args[i])+1;          if (off >= 4096)           {            palloc_free_page (kpage);            return false;          }          argAddress[i] = (void *) (PHYS_BASE - off);          memcpy(PHYS_BASE - off, args[i], strlen(args[i])+1);        }        // Push word align        for (i = 0; i < (off % 4); i++) {          off++;          if (off >= 4096)           {            palloc_free_page (kpage);            return false;          }          memset(PHYS_BASE - off, 0, 1);        }        // Push null sentinel         off += 4;        if (off >= 4096)         {          palloc_free_page (kpage);          return false;        }        memset(PHYS_BASE - off, 0, 4);        // Push address of arguments (right to left)        for (i = argc; i >= 0; i--) {          off += 4;          if (off >= 4096)           {            palloc_free_page (kpage);            return false;          }          memcpy(PHYS_BASE - off, &argAddress[i], 4);        }        // Push address of argv        off += 4;        if (off >= 4096)         {          palloc_free_page (kpage);          return false;        }        temp = PHYS_BASE - off;        *temp = (uint32_t)(PHYS_BASE - off + 4);        // Push argc        off += 4;        if (off >= 4096)         {          palloc_free_page (kpage);          return false;        }        memset(PHYS_BASE - off, argc+1, 1);        // Push fake return address        off += 4;        if (off >= 4096)         {          palloc_free_page (kpage);          return false;        }        memset(PHYS_BASE - off, 0, 4);        *esp = PHYS_BASE - off;        // Free args array        free(args);      }      else        palloc_free_page (kpage);    }  return success;}/* Adds a mapping from user virtual address UPAGE to kernel   virtual address KPAGE to the page table.   If WRITABLE is true, the user process may modify the page;   otherwise, it is read-only.   UPAGE must not already be mapped.   KPAGE should probably be a page obtained from the user pool   with palloc_get_page().   Returns true on success, false if UPAGE is already mapped or   if memory allocation fails. */static boolinstall_page (void *upage, void *kpage, bool writable){  struct thread *t = thread_current ();  /* Verify that there's not already a page at that virtual     address, then map our page there. */  return (pagedir_get_page (t->pagedir, upage) == NULL          && pagedir_set_page (t->pagedir, upage, kpage, writable));}
\ No newline at end of file
+#include "userprog/process.h"#include <debug.h>#include <inttypes.h>#include <round.h>#include <stdio.h>#include "devices/timer.h"#include "threads/malloc.h"#include <stdlib.h>#include <string.h>#include "userprog/gdt.h"#include "userprog/pagedir.h"#include "userprog/tss.h"#include "userprog/syscall.h"#include "filesys/directory.h"#include "filesys/file.h"#include "filesys/filesys.h"#include "threads/flags.h"#include "threads/init.h"#include "threads/interrupt.h"#include "threads/palloc.h"#include "threads/thread.h"#include "threads/vaddr.h"#include "process.h"#ifdef VM#include "vm/page.h"#endifstatic thread_func start_process NO_RETURN;static bool load (const char *cmdline, void (**eip) (void), void **esp);/* Child process records.   A process keeps a record of each child it starts in a hash   table, CHILDREN, keyed by tid, so that finding a child for   wait() takes constant time however many children it has.  The   child shares the record through its CP member, leaves its exit   status there, and wakes up its parent through it, so exiting   also takes constant time.  The record is reference counted:   it is freed as soon as the child has exited and the parent   has either reaped it or exited too. */static bool init_children (struct thread *);static void release_child (struct child_process *);static hash_action_func release_child_action;/* Passed from process_execute() to start_process(). */struct start_info  {    char *cmd_line;                     /* Command line, in a page. */    struct child_process *cp;           /* The new process's record. */  };/* Starts a new thread running a user program loaded from   FILENAME.  The new thread may be scheduled (and may even exit)   before process_execute() returns.  Returns the new process's   thread id, or TID_ERROR if the thread cannot be created. */tid_tprocess_execute (const char *file_name) {  char *fn_copy;  tid_t tid;  /* Make a copy of FILE_NAME.     Otherwise there's a race between the caller and load(). */  fn_copy = palloc_get_page (0);  if (fn_copy == NULL)     return TID_ERROR;  strlcpy (fn_copy, file_name, PGSIZE);  char *temp;  char *full = palloc_get_page (0);  if (full == NULL) {    palloc_free_page (fn_copy);     return TID_ERROR;  }  strlcpy (full, file_name, PGSIZE);  char *name = strtok_r (fn_copy, " ", &temp);  if (name == NULL)  {    palloc_free_page (fn_copy);     palloc_free_page (full);     return TID_ERROR;  }  /* Set up the child's record.  One reference belongs to us and     one to the child. */  struct thread *cur = thread_current ();  struct child_process *cp = slab_alloc (&child_process_cache);  if (cp == NULL || !init_children (cur))  {    if (cp != NULL)      slab_free (&child_process_cache, cp);    palloc_free_page (fn_copy);     palloc_free_page (full);     return TID_ERROR;  }  cp->parent = cur;  cp->ref_cnt = 2;  cp->exit_status = -1;  sema_init (&cp->loading_sema, 0);  sema_init (&cp->waiting_sema, 0);  sema_init (&cp->start_sema, 0);  cp->load_status = LOADING;  /* Create a new thread to execute FILE_NAME. */  struct start_info info = { full, cp };  tid = thread_create (name, PRI_DEFAULT, start_process, &info);  palloc_free_page (fn_copy);   if (tid == TID_ERROR)  {    slab_free (&child_process_cache, cp);    palloc_free_page (full);     return tid;  }  cp->tid = tid;  hash_insert (&cur->children, &cp->elem);  /* INFO must outlive the child's use of it. */  sema_down (&cp->start_sema);  if (cp->load_status != LOAD_SUCCESS)   {    hash_delete (&cur->children, &cp->elem);    release_child (cp);    return TID_ERROR;   }  return tid;}/* A thread function that loads a user process and starts it   running. */static voidstart_process (void *info_){  struct start_info *info = info_;  char *file_name = info->cmd_line;  struct intr_frame if_;  bool success;  thread_current ()->cp = info->cp;  /* Initialize interrupt frame and load executable. */  memset (&if_, 0, sizeof if_);  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;  if_.cs = SEL_UCSEG;  if_.eflags = FLAG_IF | FLAG_MBS;  success = (fd_inherit (thread_current ()->cp->parent)             && load (file_name, &if_.eip, &if_.esp));  if (!success)    thread_current()->cp->load_status = LOAD_FAILED;  else    thread_current()->cp->load_status = LOAD_SUCCESS;  // Ensure synchronization with parent  sema_up (&thread_current()->cp->loading_sema);  /* If load failed, quit. */  palloc_free_page (file_name);  sema_up (&thread_current()->cp->start_sema);  if (!success)     thread_exit ();  /* Start the user process by simulating a return from an     interrupt, implemented by intr_exit (in     threads/intr-stubs.S).  Because intr_exit takes all of its     arguments on the stack in the form of a `struct intr_frame',     we just point the stack pointer (%esp) to our stack frame     and jump to it. */  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");  NOT_REACHED ();}/* Returns the record of the running process's child CHILD_TID,   or a null pointer if it has no such child or has already   reaped it. */struct child_process* get_child_process (tid_t child_tid){  struct thread *t = thread_current();  struct child_process key;  struct hash_elem *e;  if (!t->children_init)    return NULL;  key.tid = child_tid;  e = hash_find (&t->children, &key.elem);  return e != NULL ? hash_entry (e, struct child_process, elem) : NULL;}/* Hash function for child records. */static unsignedchild_hash (const struct hash_elem *e, void *aux UNUSED){  return hash_int (hash_entry (e, struct child_process, elem)->tid);}/* Orders child records by tid. */static boolchild_less (const struct hash_elem *a, const struct hash_elem *b,            void *aux UNUSED){  return (hash_entry (a, struct child_process, elem)->tid          < hash_entry (b, struct child_process, elem)->tid);}/* Initializes T's table of children, if it has not been already.   Returns false if memory is short. */static boolinit_children (struct thread *t){  if (!t->children_init)    t->children_init = hash_init (&t->children, child_hash, child_less,                                  NULL);  return t->children_init;}/* Drops a reference to child record CP, freeing it if that was   the last one. */static voidrelease_child (struct child_process *cp){  enum intr_level old_level;  bool dead;  old_level = intr_disable ();  dead = --cp->ref_cnt == 0;  intr_set_level (old_level);  if (dead)    slab_free (&child_process_cache, cp);}/* Drops the parent's reference to the child record containing E,   for hash_destroy(). */static voidrelease_child_action (struct hash_elem *e, void *aux UNUSED){  release_child (hash_entry (e, struct child_process, elem));}/* Waits for thread TID to die and returns its exit status.  If   it was terminated by the kernel (i.e. killed due to an   exception), returns -1.  If TID is invalid or if it was not a   child of the calling process, or if process_wait() has already   been successfully called for the given TID, returns -1   immediately, without waiting.   This function will be implemented in problem 2-2.  For now, it   does nothing. */intprocess_wait (tid_t child_tid) {  struct child_process *t = get_child_process (child_tid);  if (!t) return -1;  /* Reaping removes the record, so a second wait() finds     nothing. */  hash_delete (&thread_current ()->children, &t->elem);  sema_down (&t->waiting_sema);  int status = t->exit_status;  release_child (t);  return status;}/* Free the current process's resources. */voidprocess_exit (void){  struct thread *cur = thread_current ();  uint32_t *pd;    /* Close all file descriptors */  for (int fd = 0; fd < cur->fd_cnt; fd++)    if (cur->fds[fd] != NULL)      close (fd);  free (cur->fds);  cur->fds = NULL;  cur->fd_cnt = 0;  // Finally close the file  if (cur->exec)     file_close(cur->exec);  /* Report our exit status, which exit() has recorded (or which     stays -1 if we were killed or failed to load), and give up     our records of our own children. */  if (cur->cp != NULL)  {    sema_up (&cur->cp->waiting_sema);    release_child (cur->cp);    cur->cp = NULL;  }  if (cur->children_init)  {    hash_destroy (&cur->children, release_child_action);    cur->children_init = false;  }#ifdef VM  /* Drop the supplemental page table while the page directory     is still around to unmap shared frames from. */  page_table_destroy (&cur->pages);#endif  /* Destroy the current process's page directory and switch back     to the kernel-only page directory. */  pd = cur->pagedir;  if (pd != NULL)     {      /* Correct ordering here is crucial.  We must set         cur->pagedir to NULL before switching page directories,         so that a timer interrupt can't switch back to the         process page directory.  We must activate the base page         directory before destroying the process's page         directory, or our active page directory will be one         that's been freed (and cleared). */      cur->pagedir = NULL;      pagedir_activate (NULL);      pagedir_destroy (pd);    }}/* Sets up the CPU for running user code in the current   thread.   This function is called on every context switch.   Address spaces are switched lazily.  A kernel thread, which   has no page directory, keeps running on whichever one is   loaded, since they all map kernel memory the same way, and a   process only reloads CR3 (flushing the TLB) when its page   directory is not already the active one. */voidprocess_activate (void){  struct thread *t = thread_current ();  /* Activate thread's page tables. */  if (t->pagedir != NULL && !pagedir_is_active (t->pagedir))    pagedir_activate (t->pagedir);  /* Set thread's kernel stack for use in processing     interrupts. */  tss_update ();}/* We load ELF binaries.  The following definitions are taken   from the ELF specification, [ELF1], more-or-less verbatim.  *//* ELF types.  See [ELF1] 1-2. */typedef uint32_t Elf32_Word, Elf32_Addr, Elf32_Off;typedef uint16_t Elf32_Half;/* For use with ELF types in printf(). */#define PE32Wx PRIx32   /* Print Elf32_Word in hexadecimal. */#define PE32Ax PRIx32   /* Print Elf32_Addr in hexadecimal. */#define PE32Ox PRIx32   /* Print Elf32_Off in hexadecimal. */#define PE32Hx PRIx16   /* Print Elf32_Half in hexadecimal. *//* Executable header.  See [ELF1] 1-4 to 1-8.   This appears at the very beginning of an ELF binary. */struct Elf32_Ehdr  {    unsigned char e_ident[16];    Elf32_Half    e_type;    Elf32_Half    e_machine;    Elf32_Word    e_version;    Elf32_Addr    e_entry;    Elf32_Off     e_phoff;    Elf32_Off     e_shoff;    Elf32_Word    e_flags;    Elf32_Half    e_ehsize;    Elf32_Half    e_phentsize;    Elf32_Half    e_phnum;    Elf32_Half    e_shentsize;    Elf32_Half    e_shnum;    Elf32_Half    e_shstrndx;  };/* Program header.  See [ELF1] 2-2 to 2-4.   There are e_phnum of these, starting at file offset e_phoff   (see [ELF1] 1-6). */struct Elf32_Phdr  {    Elf32_Word p_type;    Elf32_Off  p_offset;    Elf32_Addr p_vaddr;    Elf32_Addr p_paddr;    Elf32_Word p_filesz;    Elf32_Word p_memsz;    Elf32_Word p_flags;    Elf32_Word p_align;  };/* Values for p_type.  See [ELF1] 2-3. */#define PT_NULL    0            /* Ignore. */#define PT_LOAD    1            /* Loadable segment. */#define PT_DYNAMIC 2            /* Dynamic linking info. */#define PT_INTERP  3            /* Name of dynamic loader. */#define PT_NOTE    4            /* Auxiliary info. */#define PT_SHLIB   5            /* Reserved. */#define PT_PHDR    6            /* Program header table. */#define PT_STACK   0x6474e551   /* Stack segment. *//* Flags for p_flags.  See [ELF3] 2-3 and 2-4. */#define PF_X 1          /* Executable. */#define PF_W 2          /* Writable. */#define PF_R 4          /* Readable. */static bool setup_stack (void **esp, char **args, int argc);static bool validate_segment (const struct Elf32_Phdr *, struct file *);static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,                          uint32_t read_bytes, uint32_t zero_bytes,                          bool writable);/* Loads an ELF executable from FILE_NAME into the current thread.   Stores the executable's entry point into *EIP   and its initial stack pointer into *ESP.   Returns true if successful, false otherwise. */boolload (const char *file_name, void (**eip) (void), void **esp) {  struct thread *t = thread_current ();  struct Elf32_Ehdr ehdr;  struct file *file = NULL;  off_t file_ofs;  bool success = false;  int i;  /* Allocate and activate page directory. */  t->pagedir = pagedir_create ();  if (t->pagedir == NULL)   {    goto done;  }  process_activate ();#ifdef VM  if (!page_table_init (&t->pages))    goto done;#endif  /* Parse the filename into it's arguments for setting up the stack */  char *file_name_cpy = (char *)malloc(strlen(file_name)+1);  if (file_name_cpy == NULL)    goto done;  strlcpy(file_name_cpy, file_name, strlen(file_name)+1);  // Deal with multiple spaces  char* temp = NULL;  while ((temp = strstr(file_name_cpy, "  ")) != NULL)    memmove(temp, temp + 1, strlen(temp));  // Trim trailing spaces  int index = -1;  i = 0;  while(file_name_cpy[i] != '\0')  {      if(file_name_cpy[i] != ' ' && file_name_cpy[i] != '\t' && file_name_cpy[i] != '\n')      {          index= i;      }      i++;  }  file_name_cpy[index + 1] = '\0';  int count;  for (i=0, count=0; file_name_cpy[i]; i++)    count += (file_name_cpy[i] == ' ');  char **args = (char **)malloc((count+1) * sizeof(char *));  if (args == NULL)   {    free(file_name_cpy);    goto done;  }  char *rest = file_name_cpy;  char *tk = strtok_r(file_name_cpy, " ", &rest);  i = 0;  while (tk != NULL)  {    args[i] = malloc (strlen(tk) + 1);    if (args[i] == NULL)     {      goto done;    }    memcpy(args[i], tk, strlen(tk) + 1);    tk = strtok_r(rest, " \t\n", &rest);    i++;  }  // NULL sentinel   args[i] = NULL;  free(file_name_cpy);  /* Open executable file. */  file = filesys_open (args[0]);  if (file == NULL)     {      printf ("load: %s: open failed\n", args[0]);      goto done;     }  // Deny writes to executables  file_deny_write (file);  t->exec = file;  /* Read and verify executable header. */  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr      || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)      || ehdr.e_type != 2      || ehdr.e_machine != 3      || ehdr.e_version != 1      || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)      || ehdr.e_phnum > 1024)     {      printf ("load: %s: error loading executable\n", args[0]);      goto done;     }  /* Read program headers. */  file_ofs = ehdr.e_phoff;  for (i = 0; i < ehdr.e_phnum; i++)     {      struct Elf32_Phdr phdr;      if (file_ofs < 0 || file_ofs > file_length (file))      {        goto done;      }      file_seek (file, file_ofs);      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)      {        goto done;      }      file_ofs += sizeof phdr;      switch (phdr.p_type)         {        case PT_NULL:        case PT_NOTE:        case PT_PHDR:        case PT_STACK:        default:          /* Ignore this segment. */          break;        case PT_DYNAMIC:        case PT_INTERP:        case PT_SHLIB:          goto done;        case PT_LOAD:          if (validate_segment (&phdr, file))             {              bool writable = (phdr.p_flags & PF_W) != 0;              uint32_t file_page = phdr.p_offset & ~PGMASK;              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;              uint32_t page_offset = phdr.p_vaddr & PGMASK;              uint32_t read_bytes, zero_bytes;              if (phdr.p_filesz > 0)                {                  /* Normal segment.                     Read initial part from disk and zero the rest. */                  read_bytes = page_offset + phdr.p_filesz;                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)                                - read_bytes);                }              else                 {                  /* Entirely zero.                     Don't read anything from disk. */                  read_bytes = 0;                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);                }              if (!load_segment (file, file_page, (void *) mem_page,                                 read_bytes, zero_bytes, writable))              {                goto done;              }            }          else          {            goto done;          }          break;        }    }  /* Set up stack. */  if (!setup_stack (esp, args, count))  {    goto done;  }  /* Start address. */  *eip = (void (*) (void)) ehdr.e_entry;  success = true; done:  /* We arrive here whether the load is successful or not. */  //file_close (file);  return success;}/* load() helpers. */static bool install_page (void *upage, void *kpage, bool writable);static bool install_stack_page (void);/* Checks whether PHDR describes a valid, loadable segment in   FILE and returns true if so, false otherwise. */static boolvalidate_segment (const struct Elf32_Phdr *phdr, struct file *file) {  /* p_offset and p_vaddr must have the same page offset. */  if ((phdr->p_offset & PGMASK) != (phdr->p_vaddr & PGMASK))     return false;   /* p_offset must point within FILE. */  if (phdr->p_offset > (Elf32_Off) file_length (file))     return false;  /* p_memsz must be at least as big as p_filesz. */  if (phdr->p_memsz < phdr->p_filesz)     return false;   /* The segment must not be empty. */  if (phdr->p_memsz == 0)    return false;    /* The virtual memory region must both start and end within the     user address space range. */  if (!is_user_vaddr ((void *) phdr->p_vaddr))    return false;  if (!is_user_vaddr ((void *) (phdr->p_vaddr + phdr->p_memsz)))    return false;  /* The region cannot "wrap around" across the kernel virtual     address space. */  if (phdr->p_vaddr + phdr->p_memsz < phdr->p_vaddr)    return false;  /* Disallow mapping page 0.     Not only is it a bad idea to map page 0, but if we allowed     it then user code that passed a null pointer to system calls     could quite likely panic the kernel by way of null pointer     assertions in memcpy(), etc. */  if (phdr->p_vaddr < PGSIZE)    return false;  /* It's okay. */  return true;}/* Loads a segment starting at offset OFS in FILE at address   UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual   memory are initialized, as follows:        - READ_BYTES bytes at UPAGE must be read from FILE          starting at offset OFS.        - ZERO_BYTES bytes at UPAGE + READ_BYTES must be zeroed.   The pages initialized by this function must be writable by the   user process if WRITABLE is true, read-only otherwise.   Return true if successful, false if a memory allocation error   or disk read error occurs. */static boolload_segment (struct file *file, off_t ofs, uint8_t *upage,              uint32_t read_bytes, uint32_t zero_bytes, bool writable) {  ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);  ASSERT (pg_ofs (upage) == 0);  ASSERT (ofs % PGSIZE == 0);  file_seek (file, ofs);  while (read_bytes > 0 || zero_bytes > 0)     {      /* Calculate how to fill this page.         We will read PAGE_READ_BYTES bytes from FILE         and zero the final PAGE_ZERO_BYTES bytes. */      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;      size_t page_zero_bytes = PGSIZE - page_read_bytes;#ifdef VM      /* Pages with nothing to read start out sharing the zero         frame and only get memory of their own when written.         The others are read from FILE when first touched. */      if (page_read_bytes == 0          ? !page_add_zero (upage, writable)          : !page_add_file (upage, file, ofs, page_read_bytes, writable))        return false;      read_bytes -= page_read_bytes;      zero_bytes -= page_zero_bytes;      ofs += page_read_bytes;      upage += PGSIZE;      continue;#endif      /* Get a page of memory. */      uint8_t *kpage = palloc_get_page (PAL_USER);      if (kpage == NULL)        return false;      /* Load this page. */      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)        {          palloc_free_page (kpage);          return false;         }      memset (kpage + page_read_bytes, 0, page_zero_bytes);      /* Add the page to the process's address space. */      if (!install_page (upage, kpage, writable))         {          palloc_free_page (kpage);          return false;         }      /* Advance. */      read_bytes -= page_read_bytes;      zero_bytes -= page_zero_bytes;      upage += PGSIZE;    }  return true;}/* Create a minimal stack by mapping a zeroed page at the top of   user virtual memory. */static boolsetup_stack (void **esp, char **args, int argc) {  uint32_t *temp;  bool success;  /* On failure below, the stack page is freed along with the     rest of the address space. */  success = install_stack_page ();  if (success) {    void *argAddress[argc];    int off = 0;    int i;    // Push the arguments (strings) to the stack    for (i = 0; args[i] != NULL; i++) {      off += strlen(args[i])+1;      if (off >= 4096)         return false;      argAddress[i] = (void *) (PHYS_BASE - off);      memcpy(PHYS_BASE - off, args[i], strlen(args[i])+1);    }    // Push word align    for (i = 0; i < (off % 4); i++) {      off++;      if (off >= 4096)         return false;      memset(PHYS_BASE - off, 0, 1);    }    // Push null sentinel     off += 4;    if (off >= 4096)       return false;    memset(PHYS_BASE - off, 0, 4);    // Push address of arguments (right to left)    for (i = argc; i >= 0; i--) {      off += 4;      if (off >= 4096)         return false;      memcpy(PHYS_BASE - off, &argAddress[i], 4);    }    // Push address of argv    off += 4;    if (off >= 4096)       return false;    temp = PHYS_BASE - off;    *temp = (uint32_t)(PHYS_BASE - off + 4);    // Push argc    off += 4;    if (off >= 4096)       return false;    memset(PHYS_BASE - off, argc+1, 1);    // Push fake return address    off += 4;    if (off >= 4096)       return false;    memset(PHYS_BASE - off, 0, 4);    *esp = PHYS_BASE - off;    // Free args array    free(args);  }  return success;}/* Maps a zeroed page at the top of user virtual memory.   Returns true if successful, false on failure. */static boolinstall_stack_page (void){  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;#ifdef VM  /* The page gets a frame of its own when setup_stack() first     writes to it. */  return page_add_zero (upage, true);#else  uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);  if (kpage == NULL)    return false;  if (!install_page (upage, kpage, true))    {      palloc_free_page (kpage);      return false;    }  return true;#endif}/* Adds a mapping from user virtual address UPAGE to kernel   virtual address KPAGE to the page table.   If WRITABLE is true, the user process may modify the page;   otherwise, it is read-only.   UPAGE must not already be mapped.   KPAGE should probably be a page obtained from the user pool   with palloc_get_page().   Returns true on success, false if UPAGE is already mapped or   if memory allocation fails. */static boolinstall_page (void *upage, void *kpage, bool writable){  struct thread *t = thread_current ();  /* Verify that there's not already a page at that virtual     address, then map our page there. */  return (pagedir_get_page (t->pagedir, upage) == NULL          && pagedir_set_page (t->pagedir, upage, kpage, writable));}
\ No newline at end of file
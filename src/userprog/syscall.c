@@ -1,6 +1,8 @@
 #include "userprog/syscall.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "devices/shutdown.h"
 #include "devices/input.h"
 #include <syscall-nr.h>
@@ -12,15 +14,83 @@
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "process.h"
+#include "threads/palloc.h"
+#include "userprog/uaccess.h"
+#include "userprog/pagedir.h"
+#include "userprog/pipe.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 #define USER_PROCESS_MAXIMUM_ARGUMENTS 5
 
-struct process_file* get_process_file (int fd);
-void validate_user_string (char *str);
 void validate_user_address (uint8_t * addr);
+void validate_user_buffer (void *buffer, unsigned size, bool writable);
 void extract_arguments (struct intr_frame *f, int *buf, int count);
 static void syscall_handler (struct intr_frame *);
 
+/* File descriptor table.
+
+   Each process keeps its descriptors in a growable array, FDS,
+   indexed by file descriptor, so that looking up a descriptor
+   takes constant time.  Each descriptor refers to a handle for
+   the console, an open file, or one end of a pipe.  Descriptors
+   made by dup() and dup2(), and those a child inherits from its
+   parent in exec(), share a handle, and with it a file's
+   position; the handle is closed along with its last descriptor.
+   Since processes sharing a handle may use it at the same time,
+   every system call that reads or moves a file's position holds
+   the handle's POS_LOCK while it does so.
+
+   A new descriptor is the lowest free one, so descriptors are
+   reused after close(); every descriptor below the process's
+   FD_HINT is known to be in use, which saves rescanning the start
+   of the table. */
+#define FD_TABLE_INIT 16        /* Initial number of slots. */
+#define FD_MAX 1024             /* Descriptors must be below this. */
+
+/* What a handle refers to. */
+enum handle_type
+  {
+    HANDLE_KEYBOARD,            /* Console input. */
+    HANDLE_CONSOLE,             /* Console output. */
+    HANDLE_FILE,                /* An open file. */
+    HANDLE_PIPE_READ,           /* Read end of a pipe. */
+    HANDLE_PIPE_WRITE           /* Write end of a pipe. */
+  };
+
+/* An open handle, shared by one or more descriptors. */
+struct handle
+  {
+    enum handle_type type;      /* What it refers to. */
+    struct file *file;          /* HANDLE_FILE: the file. */
+    struct pipe *pipe;          /* HANDLE_PIPE_*: the pipe. */
+    int ref_cnt;                /* Number of descriptors. */
+    struct lock pos_lock;       /* HANDLE_FILE: protects position. */
+  };
+
+/* Console handles.  Every process starts out with these on
+   descriptors 0 and 1.  They last as long as the kernel, so they
+   are not reference counted. */
+static struct handle keyboard_handle = { .type = HANDLE_KEYBOARD };
+static struct handle console_handle = { .type = HANDLE_CONSOLE };
+
+/* Protects the REF_CNT of every handle, which processes that
+   share a handle may change at the same time. */
+static struct lock handle_lock;
+
+static struct handle *get_handle (int fd);
+static struct handle *get_file_handle (int fd);
+static struct file *get_file (int fd);
+static bool reserve_fd (struct thread *, int fd);
+static int alloc_fd (struct handle *);
+static void free_fd (int fd);
+static struct handle *handle_create (enum handle_type, struct file *,
+                                     struct pipe *);
+static bool is_console (const struct handle *);
+static struct handle *handle_dup (struct handle *);
+static void handle_put (struct handle *);
+
 /* Reads a byte at user virtual address UADDR.
    UADDR must be below PHYS_BASE.
    Returns the byte value if successful, -1 if a segfault
@@ -28,9 +98,11 @@ static void syscall_handler (struct intr_frame *);
 static int
 get_user (const uint8_t *uaddr)
 {
-  int result;
-  asm ("movl $1f, %0; movzbl %1, %0; 1:"
-       : "=&a" (result) : "m" (*uaddr));
+  int result = -1;
+  asm ("1: movzbl %1, %0\n"
+       "2:\n"
+       EX_TABLE_ENTRY ("1b", "2b")
+       : "+r" (result) : "m" (*uaddr));
   return result;
 }
  
@@ -40,25 +112,98 @@ get_user (const uint8_t *uaddr)
 static bool
 put_user (uint8_t *udst, uint8_t byte)
 {
-  int error_code;
-  asm ("movl $1f, %0; movb %b2, %1; 1:"
-       : "=&a" (error_code), "=m" (*udst) : "q" (byte));
-  return error_code != -1;
+  bool ok = false;
+  asm ("1: movb %b2, %0\n"
+       "   movb $1, %1\n"
+       "2:\n"
+       EX_TABLE_ENTRY ("1b", "2b")
+       : "=m" (*udst), "+q" (ok) : "q" (byte));
+  return ok;
+}
+
+/* Copies SIZE bytes from user address USRC to DST, terminating
+   the process if any of them is not valid user memory. */
+static void
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  if (copy_from_user (dst, usrc, size) != 0)
+    exit (-1);
 }
 
+/* Copies SIZE bytes from SRC to user address UDST, terminating
+   the process if any of them is not valid user memory. */
 static void
-copy_in (void *dst_, const void *usrc_, size_t size)
+copy_out (void *udst, const void *src, size_t size)
+{
+  if (copy_to_user (udst, src, size) != 0)
+    exit (-1);
+}
+
+/* Copies the string at user address USTR into a new page and
+   returns it, terminating the process if USTR is not a valid
+   string.  A string longer than a page is truncated.  The
+   caller must free the page with palloc_free_page(). */
+static char *
+copy_in_string (const char *ustr)
+{
+  char *kstr = palloc_get_page (0);
+  if (kstr == NULL)
+    exit (-1);
+
+  if (strncpy_from_user (kstr, ustr, PGSIZE) < 0)
+    {
+      palloc_free_page (kstr);
+      exit (-1);
+    }
+  kstr[PGSIZE - 1] = '\0';
+  return kstr;
+}
+
+/* Copies the IOVCNT-element array of buffers at user address
+   UIOV into IOV and checks that each buffer is accessible, and
+   writable if WRITABLE is true, terminating the process if not.
+   Returns false if IOVCNT is out of range or the buffers add up
+   to more than INT_MAX bytes. */
+static bool
+copy_in_iovec (struct iovec *iov, const struct iovec *uiov, int iovcnt,
+               bool writable)
+{
+  size_t total = 0;
+  int i;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return false;
+  copy_in (iov, uiov, iovcnt * sizeof *iov);
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len > INT_MAX - total)
+        return false;
+      total += iov[i].iov_len;
+      validate_user_buffer (iov[i].iov_base, iov[i].iov_len, writable);
+    }
+  return true;
+}
+
+/* Carries out readv() on FD if WRITE is false, or writev() if
+   WRITE is true, with the IOVCNT-element array of buffers at
+   user address UIOV.  Returns -1 if the array is invalid.  The
+   kernel copy of the array is kept here, out of line, so that
+   other system calls do not reserve stack space for it. */
+static int NO_INLINE
+vector_io (int fd, const struct iovec *uiov, int iovcnt, bool write)
 {
-  uint8_t *dst = dst_;
-  const uint8_t *usrc = usrc_;
-  for (; size > 0; size--, dst++, usrc++) 
-    *dst = get_user (usrc);
+  struct iovec iov[IOV_MAX];
+
+  if (!copy_in_iovec (iov, uiov, iovcnt, !write))
+    return -1;
+  return write ? writev (fd, iov, iovcnt) : readv (fd, iov, iovcnt);
 }
 
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  lock_init (&handle_lock);
 }
 
 
@@ -67,10 +212,13 @@ syscall_handler (struct intr_frame *f UNUSED)
 {
   unsigned syscall_number;
   int args[USER_PROCESS_MAXIMUM_ARGUMENTS];
+  char *kstr;
 
-  // Validate 4 bytes for syscall number
-  for (unsigned i=0; i<=sizeof syscall_number; i++) 
-    validate_user_address (f->esp + i);
+#ifdef VM
+  /* Page faults taken on the process's behalf below need the
+     user stack pointer to tell stack growth from a bad access. */
+  thread_current ()->user_esp = f->esp;
+#endif
 
   copy_in (&syscall_number, f->esp, sizeof syscall_number);
 
@@ -78,16 +226,60 @@ syscall_handler (struct intr_frame *f UNUSED)
   {
     case SYS_WRITE:
       extract_arguments (f, args, 3);
-      for (unsigned i=0; i < (unsigned) args[2]; i++)
-        validate_user_address ((void *) args[1] + i);
+      validate_user_buffer ((void *) args[1], (unsigned) args[2], false);
       f->eax = write (args[0], (void *)args[1], (unsigned) args[2]);
       break;
     case SYS_READ:
       extract_arguments (f, args, 3);
-      for (unsigned i=0; i < (unsigned) args[2]; i++)
-        validate_user_address ((void *) args[1] + i);
+      validate_user_buffer ((void *) args[1], (unsigned) args[2], true);
       f->eax = read (args[0], (void *)args[1], (unsigned) args[2]);
       break;
+    case SYS_PREAD:
+      extract_arguments (f, args, 4);
+      validate_user_buffer ((void *) args[1], (unsigned) args[2], true);
+      f->eax = pread (args[0], (void *) args[1], (unsigned) args[2],
+                      (unsigned) args[3]);
+      break;
+    case SYS_PWRITE:
+      extract_arguments (f, args, 4);
+      validate_user_buffer ((void *) args[1], (unsigned) args[2], false);
+      f->eax = pwrite (args[0], (void *) args[1], (unsigned) args[2],
+                       (unsigned) args[3]);
+      break;
+    case SYS_READV:
+      extract_arguments (f, args, 3);
+      f->eax = vector_io (args[0], (const struct iovec *) args[1], args[2],
+                          false);
+      break;
+    case SYS_WRITEV:
+      extract_arguments (f, args, 3);
+      f->eax = vector_io (args[0], (const struct iovec *) args[1], args[2],
+                          true);
+      break;
+    case SYS_COPY_FILE_RANGE:
+      extract_arguments (f, args, 3);
+      f->eax = copy_file_range (args[0], args[1], (unsigned) args[2]);
+      break;
+    case SYS_RING_SETUP:
+      extract_arguments (f, args, 1);
+      f->eax = ring_setup ((struct ring *) args[0]);
+      break;
+    case SYS_RING_ENTER:
+      extract_arguments (f, args, 1);
+      f->eax = ring_enter ((unsigned) args[0]);
+      break;
+    case SYS_PIPE:
+      extract_arguments (f, args, 1);
+      f->eax = pipe ((int *) args[0]);
+      break;
+    case SYS_DUP:
+      extract_arguments (f, args, 1);
+      f->eax = dup (args[0]);
+      break;
+    case SYS_DUP2:
+      extract_arguments (f, args, 2);
+      f->eax = dup2 (args[0], args[1]);
+      break;
     case SYS_EXIT:
       extract_arguments (f, args, 1);
       exit (args[0]);
@@ -97,23 +289,27 @@ syscall_handler (struct intr_frame *f UNUSED)
       break;
     case SYS_EXEC:
       extract_arguments (f, args, 1);
-      validate_user_string ((char *)args[0]);
-      f->eax = exec ((char *)args[0]);
+      kstr = copy_in_string ((const char *) args[0]);
+      f->eax = exec (kstr);
+      palloc_free_page (kstr);
       break;
     case SYS_CREATE:
       extract_arguments (f, args, 2);
-      validate_user_string ((char *)args[0]);
-      f->eax = create ((char *)args[0], (unsigned) args[1]);
+      kstr = copy_in_string ((const char *) args[0]);
+      f->eax = create (kstr, (unsigned) args[1]);
+      palloc_free_page (kstr);
       break;
     case SYS_REMOVE:
       extract_arguments (f, args, 1);
-      validate_user_string ((char *)args[0]);
-      f->eax = remove ((char *)args[0]);
+      kstr = copy_in_string ((const char *) args[0]);
+      f->eax = remove (kstr);
+      palloc_free_page (kstr);
       break;
     case SYS_OPEN:
       extract_arguments (f, args, 1);
-      validate_user_string ((char *)args[0]);
-      f->eax = open ((char *)args[0]);
+      kstr = copy_in_string ((const char *) args[0]);
+      f->eax = open (kstr);
+      palloc_free_page (kstr);
       break;
     case SYS_CLOSE:
       extract_arguments (f, args, 1);
@@ -151,29 +347,23 @@ wait (tid_t tid)
 void
 seek (int fd, unsigned position)
 {
-  lock_acquire (&file_lock);
-  struct process_file *pf = get_process_file (fd);
-  if (!pf)
-  {
-    lock_release(&file_lock);
+  struct handle *h = get_file_handle (fd);
+  if (!h)
     return;
-  }
-  file_seek(pf->file, position);
-  lock_release(&file_lock);
+  lock_acquire (&h->pos_lock);
+  file_seek(h->file, position);
+  lock_release (&h->pos_lock);
 }
 
 unsigned
 tell (int fd)
 {
-  lock_acquire (&file_lock);
-  struct process_file *pf = get_process_file (fd);
-  if (!pf)
-  {
-    lock_release(&file_lock);
+  struct handle *h = get_file_handle (fd);
+  if (!h)
     return -1;
-  }
-  off_t offset = file_tell(pf->file);
-  lock_release(&file_lock);
+  lock_acquire (&h->pos_lock);
+  off_t offset = file_tell(h->file);
+  lock_release (&h->pos_lock);
   return offset;
 }
 
@@ -183,133 +373,396 @@ read (int fd, void *buffer, unsigned size)
   if (size <= 0) 
     return size;
   
-  //Keyboard input
-  if (fd == 0)
+  struct handle *h = get_handle (fd);
+  if (!h)
+    return -1;
+  switch (h->type)
   {
-    for (unsigned i = 0; i < size; i++)
+    case HANDLE_KEYBOARD:
+      for (unsigned i = 0; i < size; i++)
+        *((uint8_t *)buffer + i) = input_getc(); 
+      return size;
+    case HANDLE_FILE:
     {
-      validate_user_address (buffer + i);
-      *((uint8_t *)buffer + i) = input_getc(); 
+      int bytes_read;
+
+      lock_acquire (&h->pos_lock);
+      bytes_read = file_read (h->file, buffer, size);
+      lock_release (&h->pos_lock);
+      return bytes_read;
     }
-    return size;
-  }
-  else
-  {
-    lock_acquire (&file_lock);
-    struct process_file *pf = get_process_file (fd);
-    if (!pf)
-    {
-      lock_release(&file_lock);
+    case HANDLE_PIPE_READ:
+      return pipe_read (h->pipe, buffer, size);
+    default:
       return -1;
-    }
-    int bytes = file_read(pf->file, buffer, size);
-    lock_release(&file_lock);
-    return bytes;
   }
 }
 
 int 
 filesize (int fd)
 {
-  lock_acquire (&file_lock);
-  struct process_file *pf = get_process_file (fd);
-  if (!pf)
-  {
-    lock_release(&file_lock);
+  struct file *file = get_file (fd);
+  if (!file)
     return -1;
-  }
-  int filesize = file_length(pf->file);
-  lock_release (&file_lock);
+  int filesize = file_length(file);
   return filesize;
 }
 
 void
 close (int fd)
 {
-  lock_acquire (&file_lock);
-  struct process_file *pf = get_process_file (fd);
-  if (!pf)
-  {
-    lock_release(&file_lock);
+  struct handle *h = get_handle (fd);
+  if (!h)
     return;
-  }
-  file_close(pf->file);
-  list_remove(&pf->elem);
-  free(pf);
-  lock_release(&file_lock);
+  /* Closing the console on descriptor 0 or 1 does nothing, so
+     that a process cannot cut itself off from the console. */
+  if (fd <= STDOUT_FILENO && is_console (h))
+    return;
+  free_fd (fd);
+  handle_put (h);
   return;
 }
 
 int
 open (const char *file)
 {
-  lock_acquire (&file_lock);
   struct file *open_file = filesys_open(file);
   if (!open_file)
   {
-    lock_release (&file_lock);
     return -1;
   }
-  struct process_file *pf = malloc(sizeof(struct process_file));
-  if (pf == NULL)
+  struct handle *h = handle_create (HANDLE_FILE, open_file, NULL);
+  if (!h)
   {
-    free(open_file);
+    file_close (open_file);
     return -1;
   }
-  pf->file = open_file;
-  pf->fd = thread_current ()->fd_inc++;
-  list_push_front (&thread_current()->open_files, &pf->elem);
-  lock_release (&file_lock);
-  return pf->fd;
+  int fd = alloc_fd (h);
+  if (fd < 0)
+    handle_put (h);
+  return fd;
 }
 
 bool
 remove (const char *file)
 {
-  lock_acquire (&file_lock);
   bool successful = filesys_remove(file);
-  lock_release (&file_lock);
   return successful;
 }
 
 bool
 create (const char *file, unsigned initial_size) 
 {
-  lock_acquire (&file_lock);
   bool successful = filesys_create(file, initial_size);
-  lock_release (&file_lock);
   return successful;
 }
 
 int
 write (int fd, void *buffer, unsigned size)
 {
-  if (fd == 1) // Writing to the console
-  {  
-    unsigned bytes_written = 0;
+  struct handle *h = get_handle (fd);
+  if (!h)
+    return -1;
+  switch (h->type)
+  {
+    case HANDLE_CONSOLE:
+    {  
+      unsigned bytes_written = 0;
 
-    while (size > 0) 
+      while (size > 0) 
+      {
+        unsigned chunk_size = size < 256 ? size : 256;
+        putbuf ((const char *)buffer + bytes_written, chunk_size);
+        bytes_written += chunk_size;
+        size -= chunk_size;
+      }
+      return bytes_written;
+    }
+    case HANDLE_FILE:
     {
-      unsigned chunk_size = size < 256 ? size : 256;
-      putbuf ((const char *)buffer + bytes_written, chunk_size);
-      bytes_written += chunk_size;
-      size -= chunk_size;
+      int bytes_written;
+
+      lock_acquire (&h->pos_lock);
+      bytes_written = file_write (h->file, buffer, size);
+      lock_release (&h->pos_lock);
+      return bytes_written;
     }
-    return bytes_written;
+    case HANDLE_PIPE_WRITE:
+      return pipe_write (h->pipe, buffer, size);
+    default:
+      return -1;
   }
-  else 
-  {
-    lock_acquire (&file_lock);  
-    struct process_file *pf = get_process_file (fd);
-    if (!pf)
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct file *file = get_file (fd);
+  if (!file || (off_t) offset < 0)
+    return -1;
+  return file_read_at (file, buffer, size, offset);
+}
+
+int
+pwrite (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct file *file = get_file (fd);
+  if (!file || (off_t) offset < 0)
+    return -1;
+  return file_write_at (file, buffer, size, offset);
+}
+
+/* Reads into each of the IOVCNT buffers in IOV in turn, stopping
+   early at end of file.  IOV must already have been checked. */
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  int total = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
     {
-      lock_release(&file_lock);
+      int bytes = read (fd, iov[i].iov_base, iov[i].iov_len);
+      if (bytes < 0)
+        return total > 0 ? total : -1;
+      total += bytes;
+      if ((size_t) bytes < iov[i].iov_len)
+        break;
+    }
+  return total;
+}
+
+/* Writes each of the IOVCNT buffers in IOV in turn, stopping
+   early after a short write.  IOV must already have been
+   checked. */
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  int total = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      int bytes = write (fd, iov[i].iov_base, iov[i].iov_len);
+      if (bytes < 0)
+        return total > 0 ? total : -1;
+      total += bytes;
+      if ((size_t) bytes < iov[i].iov_len)
+        break;
+    }
+  return total;
+}
+
+/* Copies up to LENGTH bytes from IN_FD to OUT_FD, at and
+   advancing their current positions, without passing the data
+   through user memory.  Returns the number of bytes copied, 0 at
+   end of file, or -1 if either descriptor is not an open file. */
+int
+copy_file_range (int in_fd, int out_fd, unsigned length)
+{
+  struct handle *in = get_file_handle (in_fd);
+  struct handle *out = get_file_handle (out_fd);
+  struct handle *first, *second;
+  int copied;
+
+  if (!in || !out)
+    return -1;
+  if (length > INT_MAX)
+    length = INT_MAX;
+
+  /* Lock both positions in address order, so that two copies in
+     opposite directions cannot deadlock. */
+  first = in < out ? in : out;
+  second = in < out ? out : in;
+  lock_acquire (&first->pos_lock);
+  if (second != first)
+    lock_acquire (&second->pos_lock);
+  copied = file_copy (out->file, in->file, length);
+  if (second != first)
+    lock_release (&second->pos_lock);
+  lock_release (&first->pos_lock);
+  return copied;
+}
+
+/* Registers RING, which must be page-aligned, as the running
+   process's system call ring and empties both of its queues.  A
+   null RING unregisters the current ring.  Returns true if
+   successful, false if RING is misaligned. */
+bool
+ring_setup (struct ring *ring)
+{
+  static const unsigned zero[4];
+
+  if (pg_ofs (ring) != 0)
+    return false;
+  if (ring != NULL)
+    {
+      validate_user_buffer (ring, sizeof *ring, true);
+      copy_out (ring, zero, sizeof zero);
+    }
+  thread_current ()->ring = ring;
+  return true;
+}
+
+/* Carries out the system call described by SQE on behalf of
+   ring_enter() and returns its result. */
+static int
+ring_dispatch (const struct ring_sqe *sqe)
+{
+  char *kstr;
+  int result;
+
+  switch (sqe->opcode)
+    {
+    case RING_OP_READ:
+      validate_user_buffer (sqe->buf, sqe->len, true);
+      return read (sqe->fd, sqe->buf, sqe->len);
+    case RING_OP_WRITE:
+      validate_user_buffer (sqe->buf, sqe->len, false);
+      return write (sqe->fd, sqe->buf, sqe->len);
+    case RING_OP_OPEN:
+      kstr = copy_in_string (sqe->buf);
+      result = open (kstr);
+      palloc_free_page (kstr);
+      return result;
+    case RING_OP_CLOSE:
+      close (sqe->fd);
+      return 0;
+    default:
       return -1;
     }
-    int bytes = file_write(pf->file, buffer, size);
-    lock_release (&file_lock);
-    return bytes;
-  }
+}
+
+/* Runs up to TO_SUBMIT of the system calls queued in the running
+   process's ring, in order, posting a completion for each.  Every
+   call has finished by the time this returns, so there is
+   nothing further to wait for.  Stops early if the submission
+   queue empties or the completion queue fills.  Returns the
+   number of calls run, or -1 if no ring is registered or its
+   indexes are inconsistent. */
+int
+ring_enter (unsigned to_submit)
+{
+  struct ring *ring = thread_current ()->ring;
+  unsigned sq_head, sq_tail, cq_head, cq_tail;
+  unsigned cnt, i;
+
+  if (ring == NULL)
+    return -1;
+  copy_in (&sq_head, &ring->sq_head, sizeof sq_head);
+  copy_in (&sq_tail, &ring->sq_tail, sizeof sq_tail);
+  copy_in (&cq_head, &ring->cq_head, sizeof cq_head);
+  copy_in (&cq_tail, &ring->cq_tail, sizeof cq_tail);
+  if (sq_tail - sq_head > RING_ENTRIES || cq_tail - cq_head > RING_ENTRIES)
+    return -1;
+
+  cnt = sq_tail - sq_head;
+  if (cnt > RING_ENTRIES - (cq_tail - cq_head))
+    cnt = RING_ENTRIES - (cq_tail - cq_head);
+  if (cnt > to_submit)
+    cnt = to_submit;
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct ring_sqe sqe;
+      struct ring_cqe cqe;
+
+      copy_in (&sqe, &ring->sq[sq_head++ & RING_MASK], sizeof sqe);
+      cqe.result = ring_dispatch (&sqe);
+      cqe.user_data = sqe.user_data;
+      copy_out (&ring->cq[cq_tail++ & RING_MASK], &cqe, sizeof cqe);
+    }
+
+  copy_out (&ring->sq_head, &sq_head, sizeof sq_head);
+  copy_out (&ring->cq_tail, &cq_tail, sizeof cq_tail);
+  return cnt;
+}
+
+/* Creates a pipe and stores descriptors for its read and write
+   ends in FDS[0] and FDS[1], respectively.  Returns true if
+   successful, false if memory or descriptors ran out. */
+bool
+pipe (int *fds)
+{
+  struct pipe *p = pipe_create ();
+  struct handle *reader, *writer;
+  int kfds[2];
+
+  if (p == NULL)
+    return false;
+  reader = handle_create (HANDLE_PIPE_READ, NULL, p);
+  if (reader == NULL)
+    {
+      pipe_close (p, false);
+      pipe_close (p, true);
+      return false;
+    }
+  writer = handle_create (HANDLE_PIPE_WRITE, NULL, p);
+  if (writer == NULL)
+    {
+      handle_put (reader);
+      pipe_close (p, true);
+      return false;
+    }
+
+  kfds[0] = alloc_fd (reader);
+  if (kfds[0] < 0)
+    {
+      handle_put (reader);
+      handle_put (writer);
+      return false;
+    }
+  kfds[1] = alloc_fd (writer);
+  if (kfds[1] < 0)
+    {
+      close (kfds[0]);
+      handle_put (writer);
+      return false;
+    }
+
+  copy_out (fds, kfds, sizeof kfds);
+  return true;
+}
+
+/* Returns a new descriptor, the lowest free one, that shares
+   FD's handle, or -1 if FD is not open or no descriptor is
+   free. */
+int
+dup (int fd)
+{
+  struct handle *h = get_handle (fd);
+  int new_fd;
+
+  if (!h)
+    return -1;
+  new_fd = alloc_fd (handle_dup (h));
+  if (new_fd < 0)
+    handle_put (h);
+  return new_fd;
+}
+
+/* Makes NEW_FD share OLD_FD's handle, first closing NEW_FD if it
+   is open.  Returns NEW_FD, or -1 if OLD_FD is not open or NEW_FD
+   is out of range. */
+int
+dup2 (int old_fd, int new_fd)
+{
+  struct thread *t = thread_current ();
+  struct handle *h = get_handle (old_fd);
+  struct handle *old;
+
+  if (!h || new_fd < 0 || new_fd >= FD_MAX)
+    return -1;
+  if (new_fd == old_fd)
+    return new_fd;
+  if (!reserve_fd (t, new_fd))
+    return -1;
+
+  old = t->fds[new_fd];
+  t->fds[new_fd] = handle_dup (h);
+  if (old != NULL)
+    handle_put (old);
+  return new_fd;
 }
 
 void
@@ -318,7 +771,6 @@ exit (int status)
   struct thread *cur = thread_current();
   printf("%s: exit(%d)\n", cur->name, status);
   cur->cp->exit_status = status;
-  sema_up (&cur->cp->waiting_sema);
   thread_exit ();
 }
 
@@ -356,52 +808,243 @@ exec (const char *cmd_line)
 */
 
 void
-validate_user_string (char *str) 
+validate_user_address (uint8_t * addr)
 {
-  int i=0;
-  while (get_user ((uint8_t *) str + i) != '\0') 
-  {
-    validate_user_address ((uint8_t *) str + i);
-    i++;
-  }
+  if (is_kernel_vaddr (addr) || get_user (addr) == -1) 
+    exit (-1);
 }
 
+/* Returns true if the running process may write to the user
+   page containing ADDR, which must be mapped or have been
+   probed. */
+static bool
+is_writable_page (const void *addr)
+{
+#ifdef VM
+  /* Pages that are not yet written may be mapped read-only for
+     copy-on-write, so go by the supplemental page table. */
+  struct page *p = page_lookup (addr);
+  return p != NULL && p->writable;
+#else
+  return pagedir_is_writable (thread_current ()->pagedir, addr);
+#endif
+}
+
+/* Checks that the SIZE bytes starting at BUFFER are all user
+   memory that the process may access, and may write if WRITABLE
+   is true, and terminates the process if not.  Each page of the
+   buffer is checked once: it passes if the page table maps it,
+   and is otherwise probed like validate_user_address() so that
+   pages not yet loaded are faulted in.  The kernel has no fixup
+   for its own writes to user buffers, so a destination buffer
+   in a read-only page must be caught here. */
 void
-validate_user_address (uint8_t * addr)
+validate_user_buffer (void *buffer, unsigned size, bool writable)
 {
-  if (is_kernel_vaddr (addr) || get_user (addr) == -1) 
+  uint8_t *start = buffer;
+  uint8_t *end = start + size;
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *page;
+
+  if (size == 0)
+    return;
+  if (end < start || is_kernel_vaddr (end - 1))
     exit (-1);
+
+  for (page = pg_round_down (start); page < end; page += PGSIZE)
+    {
+      uint8_t *addr = page < start ? start : page;
+      if (pagedir_get_page (pd, addr) == NULL)
+        validate_user_address (addr);
+      if (writable && !is_writable_page (addr))
+        exit (-1);
+    }
 }
 
 void 
 extract_arguments (struct intr_frame *f, int *buf, int count) 
 {
-  uint32_t *user_ptr = (uint32_t *)f->esp + 1;
+  copy_in (buf, (uint32_t *) f->esp + 1, count * sizeof *buf);
+}
 
-  // Validate each address
-  for (int i = 0; i < count; i++) 
-  {
-    uint32_t *current_addr = user_ptr + i;
-    validate_user_address ((void *)current_addr);
-    buf[i] = *user_ptr;
-    user_ptr++;
-  }
+/* Returns the handle open as FD in the running process, or a
+   null pointer if FD is not open. */
+static struct handle *
+get_handle (int fd)
+{
+  struct thread *t = thread_current ();
+
+  if (fd < 0 || fd >= t->fd_cnt)
+    return NULL;
+  return t->fds[fd];
 }
 
-struct process_file*
-get_process_file (int fd)
+/* Returns the handle for the file open as FD in the running
+   process, or a null pointer if FD is not open or is not a
+   file. */
+static struct handle *
+get_file_handle (int fd)
 {
-  struct thread *t = thread_current();
-  struct list_elem* next;
-  
-  for (struct list_elem* e = list_begin(&t->open_files); e != list_end(&t->open_files); e = next)
-  {
-    next = list_next(e);
-    struct process_file *pf = list_entry(e, struct process_file, elem);
-    if (fd == pf->fd)
+  struct handle *h = get_handle (fd);
+
+  if (h == NULL || h->type != HANDLE_FILE)
+    return NULL;
+  return h;
+}
+
+/* Returns the file open as FD in the running process, or a
+   null pointer if FD is not open or is not a file. */
+static struct file *
+get_file (int fd)
+{
+  struct handle *h = get_file_handle (fd);
+
+  return h != NULL ? h->file : NULL;
+}
+
+/* Grows T's descriptor table, if necessary, so that it has a
+   slot for FD.  Returns false if memory is short. */
+static bool
+reserve_fd (struct thread *t, int fd)
+{
+  struct handle **fds;
+  int new_cnt;
+
+  if (fd < t->fd_cnt)
+    return true;
+
+  new_cnt = t->fd_cnt > 0 ? t->fd_cnt : FD_TABLE_INIT;
+  while (new_cnt <= fd)
+    new_cnt *= 2;
+  fds = realloc (t->fds, new_cnt * sizeof *fds);
+  if (fds == NULL)
+    return false;
+  memset (fds + t->fd_cnt, 0, (new_cnt - t->fd_cnt) * sizeof *fds);
+  t->fds = fds;
+  t->fd_cnt = new_cnt;
+  return true;
+}
+
+/* Gives handle H the lowest free descriptor in the running
+   process and returns it, or returns -1 if the table cannot
+   grow. */
+static int
+alloc_fd (struct handle *h)
+{
+  struct thread *t = thread_current ();
+  int fd;
+
+  for (fd = t->fd_hint; fd < t->fd_cnt; fd++)
+    if (t->fds[fd] == NULL)
+      break;
+  if (fd >= FD_MAX || !reserve_fd (t, fd))
+    return -1;
+
+  t->fds[fd] = h;
+  t->fd_hint = fd + 1;
+  return fd;
+}
+
+/* Marks FD free in the running process. */
+static void
+free_fd (int fd)
+{
+  struct thread *t = thread_current ();
+
+  t->fds[fd] = NULL;
+  if (fd < t->fd_hint)
+    t->fd_hint = fd;
+}
+
+/* Gives the running process, which is just starting, its
+   descriptors: copies of PARENT's if PARENT is a user process,
+   otherwise the console on descriptors 0 and 1.  Returns false
+   if memory is short. */
+bool
+fd_inherit (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  int fd;
+
+  if (parent->fds == NULL)
+    return (alloc_fd (handle_dup (&keyboard_handle)) == STDIN_FILENO
+            && alloc_fd (handle_dup (&console_handle)) == STDOUT_FILENO);
+
+  if (!reserve_fd (t, parent->fd_cnt - 1))
+    return false;
+  for (fd = 0; fd < parent->fd_cnt; fd++)
+    if (parent->fds[fd] != NULL)
+      t->fds[fd] = handle_dup (parent->fds[fd]);
+  t->fd_hint = parent->fd_hint;
+  return true;
+}
+
+/* Returns a new handle of the given TYPE for FILE or PIPE, with
+   one reference, or a null pointer if memory is short. */
+static struct handle *
+handle_create (enum handle_type type, struct file *file, struct pipe *p)
+{
+  struct handle *h = malloc (sizeof *h);
+
+  if (h != NULL)
     {
-      return pf;
+      h->type = type;
+      h->file = file;
+      h->pipe = p;
+      h->ref_cnt = 1;
+      lock_init (&h->pos_lock);
     }
-  }
-  return NULL;
-}
\ No newline at end of file
+  return h;
+}
+
+/* Returns true if H is one of the console handles. */
+static bool
+is_console (const struct handle *h)
+{
+  return h == &keyboard_handle || h == &console_handle;
+}
+
+/* Adds a reference to H and returns H. */
+static struct handle *
+handle_dup (struct handle *h)
+{
+  if (!is_console (h))
+    {
+      lock_acquire (&handle_lock);
+      h->ref_cnt++;
+      lock_release (&handle_lock);
+    }
+  return h;
+}
+
+/* Drops a reference to H, closing and freeing it if that was
+   the last one. */
+static void
+handle_put (struct handle *h)
+{
+  bool dead;
+
+  if (is_console (h))
+    return;
+  lock_acquire (&handle_lock);
+  dead = --h->ref_cnt == 0;
+  lock_release (&handle_lock);
+  if (!dead)
+    return;
+
+  switch (h->type)
+    {
+    case HANDLE_FILE:
+      file_close (h->file);
+      break;
+    case HANDLE_PIPE_READ:
+      pipe_close (h->pipe, false);
+      break;
+    case HANDLE_PIPE_WRITE:
+      pipe_close (h->pipe, true);
+      break;
+    default:
+      NOT_REACHED ();
+    }
+  free (h);
+}
@@ -1,13 +1,12 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <ring.h>
+#include <uio.h>
 #include "threads/thread.h"
 
 void syscall_init (void);
 
-/* Lock used when interacting with the file system */
-struct lock file_lock;
-
 /* System call handlers */
 
 int wait (tid_t tid);
@@ -23,5 +22,17 @@ void exit (int status);
 int write (int fd, void *buffer, unsigned size);
 void halt (void);
 tid_t exec (const char *cmd_line);
+int pread (int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite (int fd, void *buffer, unsigned size, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+bool ring_setup (struct ring *);
+int ring_enter (unsigned to_submit);
+bool pipe (int *fds);
+int dup (int fd);
+int dup2 (int old_fd, int new_fd);
+
+bool fd_inherit (struct thread *parent);
 
 #endif /* userprog/syscall.h */
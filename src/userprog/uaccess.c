@@ -0,0 +1,108 @@
+#include "userprog/uaccess.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+#include "threads/vaddr.h"
+
+/* Bounds of the exception table, from the linker script. */
+extern const struct ex_table_entry __start_ex_table[], __stop_ex_table[];
+
+static size_t copy_bytes (void *dst, const void *src, size_t size);
+
+/* Returns the fixup address for a kernel fault at EIP, or a null
+   pointer if EIP is not in the exception table. */
+void *
+search_exception_table (const void *eip) 
+{
+  const struct ex_table_entry *e;
+
+  for (e = __start_ex_table; e < __stop_ex_table; e++)
+    if (e->insn == (uintptr_t) eip)
+      return (void *) e->fixup;
+  return NULL;
+}
+
+/* Returns true if the SIZE bytes at UADDR lie entirely in user
+   memory. */
+static bool
+is_user_range (const void *uaddr, size_t size) 
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns the number of bytes that could NOT be copied,
+   so 0 on success. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size) 
+{
+  if (!is_user_range (usrc, size))
+    return size;
+  return copy_bytes (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns the number of bytes that could NOT be copied,
+   so 0 on success. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size) 
+{
+  if (!is_user_range (udst, size))
+    return size;
+  return copy_bytes (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   the SIZE-byte buffer DST.  Returns the length of the string,
+   not counting the null terminator, if it fits, or SIZE if no
+   null terminator was found in the first SIZE bytes (in which
+   case DST is not terminated).  Returns -1 if USRC is not a
+   valid user address. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size) 
+{
+  size_t copied = 0;
+
+  /* Copy a page at a time, so that we never fault on the page
+     after the one the string ends in. */
+  while (copied < size)
+    {
+      const char *src = usrc + copied;
+      size_t chunk = PGSIZE - pg_ofs (src);
+      const char *nul;
+
+      if (chunk > size - copied)
+        chunk = size - copied;
+      if (copy_from_user (dst + copied, src, chunk) != 0)
+        return -1;
+
+      nul = memchr (dst + copied, '\0', chunk);
+      if (nul != NULL)
+        return nul - dst;
+      copied += chunk;
+    }
+  return size;
+}
+
+/* Copies SIZE bytes from SRC to DST a word at a time, then the
+   remaining bytes one at a time.  If either string instruction
+   faults, stops and returns the number of bytes not copied. */
+static size_t
+copy_bytes (void *dst, const void *src, size_t size) 
+{
+  size_t left;
+
+  asm volatile ("1: rep movsl\n"
+                "   movl %3, %0\n"
+                "2: rep movsb\n"
+                "   jmp 4f\n"
+                "3: leal (%3,%0,4), %0\n"
+                "4:\n"
+                EX_TABLE_ENTRY ("1b", "3b")
+                EX_TABLE_ENTRY ("2b", "4b")
+                : "=&c" (left), "+D" (dst), "+S" (src)
+                : "r" (size & 3), "0" (size / 4)
+                : "memory");
+  return left;
+}
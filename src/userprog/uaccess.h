@@ -0,0 +1,32 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Exception table.
+
+   Kernel code that touches user memory lists each instruction
+   that may fault on a bad user address, together with a "fixup"
+   address to resume at if it does.  page_fault() looks up the
+   faulting instruction in the table instead of killing the
+   kernel.  EX_TABLE_ENTRY emits an entry from inline assembly,
+   e.g. EX_TABLE_ENTRY ("1b", "2f"). */
+struct ex_table_entry
+  {
+    uintptr_t insn;             /* Address of faulting instruction. */
+    uintptr_t fixup;            /* Where to resume. */
+  };
+
+#define EX_TABLE_ENTRY(INSN, FIXUP)             \
+        ".section __ex_table, \"a\"\n"          \
+        "  .long " INSN ", " FIXUP "\n"         \
+        ".previous\n"
+
+void *search_exception_table (const void *eip);
+
+size_t copy_from_user (void *dst, const void *usrc, size_t size);
+size_t copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+
+#endif /* userprog/uaccess.h */
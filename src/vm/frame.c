@@ -0,0 +1,348 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+/* Frame table.
+
+   Every user frame handed out by the VM code is on FRAME_LIST.
+   Frames are reclaimed with the clock algorithm, mostly by a
+   kernel "pageout" thread: when the number of free user frames
+   drops below LOW_WATERMARK the thread wakes up and evicts
+   batches of pages until HIGH_WATERMARK frames are free again,
+   writing each batch's dirty pages to swap together.  A faulting
+   thread therefore usually finds a free frame waiting for it,
+   and only evicts a page itself if the pool is empty. */
+
+static struct list frame_list;      /* All frames in use. */
+static struct list_elem *clock_hand;/* Next frame to examine. */
+static struct lock frame_lock;      /* Protects frames and their pages. */
+static struct condition evicted;    /* Signaled when evictions finish. */
+
+/* Page-out daemon. */
+#define PAGEOUT_BATCH 16            /* Max pages evicted per pass. */
+static size_t low_watermark;        /* Wake the daemon below this. */
+static size_t high_watermark;       /* Evict until this many free. */
+static struct semaphore pageout_sema;
+static bool pageout_pending;        /* Has the daemon been woken? */
+
+/* Statistics. */
+static long long pageout_cnt;       /* # of pages evicted by daemon. */
+static long long direct_cnt;        /* # of pages evicted on fault. */
+static long long swap_out_cnt;      /* # of pages written to swap. */
+
+/* A frame chosen for eviction. */
+struct victim
+  {
+    struct frame *frame;            /* Frame to evict (pinned). */
+    swap_slot_t slot;               /* Slot to write to, if dirty. */
+  };
+
+static thread_func pageout_daemon NO_RETURN;
+static size_t select_victims (struct victim *, size_t max);
+static void write_victims (struct victim *, size_t cnt);
+static void finish_victim (struct victim *);
+static void remove_frame (struct frame *);
+
+/* Initializes the frame table and starts the page-out daemon.
+   Must be called after swap_init(). */
+void
+frame_init (void)
+{
+  size_t user_frames = palloc_free_cnt (PAL_USER);
+
+  list_init (&frame_list);
+  clock_hand = NULL;
+  lock_init (&frame_lock);
+  cond_init (&evicted);
+  sema_init (&pageout_sema, 0);
+
+  low_watermark = user_frames / 32 + 1;
+  high_watermark = 2 * low_watermark;
+  thread_create ("pageout", PRI_DEFAULT, pageout_daemon, NULL);
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frame: %lld pages evicted by pageout, %lld on fault, "
+          "%lld written to swap\n",
+          pageout_cnt, direct_cnt, swap_out_cnt);
+}
+
+/* Allocates a frame for page P of the running thread, zeroing it
+   if ZERO is true, and records it as P's frame.  The frame is
+   returned pinned; the caller must fill it, map it, and then
+   call frame_unpin().  Returns a null pointer if no frame could
+   be found even by evicting a page. */
+struct frame *
+frame_alloc (struct page *p, bool zero)
+{
+  struct frame *f;
+  void *kpage;
+
+  kpage = palloc_get_page (PAL_USER | (zero ? PAL_ZERO : 0));
+
+  lock_acquire (&frame_lock);
+  if (kpage != NULL)
+    {
+      f = malloc (sizeof *f);
+      if (f == NULL)
+        {
+          lock_release (&frame_lock);
+          palloc_free_page (kpage);
+          return NULL;
+        }
+      f->kpage = kpage;
+      list_push_back (&frame_list, &f->elem);
+    }
+  else
+    {
+      /* The pool is empty: evict a page ourselves and take over
+         its frame. */
+      struct victim v;
+
+      if (select_victims (&v, 1) == 0)
+        {
+          lock_release (&frame_lock);
+          return NULL;
+        }
+      lock_release (&frame_lock);
+      write_victims (&v, 1);
+      lock_acquire (&frame_lock);
+      finish_victim (&v);
+      direct_cnt++;
+
+      f = v.frame;
+      if (zero)
+        memset (f->kpage, 0, PGSIZE);
+    }
+  f->page = p;
+  f->owner = thread_current ();
+  f->pinned = true;
+  p->frame = f;
+
+  if (!pageout_pending && palloc_free_cnt (PAL_USER) < low_watermark)
+    {
+      pageout_pending = true;
+      sema_up (&pageout_sema);
+    }
+  lock_release (&frame_lock);
+  return f;
+}
+
+/* Makes F, which its owner has finished filling and mapping,
+   eligible for eviction. */
+void
+frame_unpin (struct frame *f)
+{
+  lock_acquire (&frame_lock);
+  ASSERT (f->pinned);
+  f->pinned = false;
+  lock_release (&frame_lock);
+}
+
+/* Returns true if free user frames have dropped below the
+   page-out daemon's low watermark. */
+bool
+frame_memory_low (void)
+{
+  return palloc_free_cnt (PAL_USER) < low_watermark;
+}
+
+/* Releases frame F and detaches it from its page.
+   The frame table lock must be held and F must not be in the
+   middle of an eviction. */
+void
+frame_free (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  f->page->frame = NULL;
+  remove_frame (f);
+}
+
+/* Acquires the frame table lock, which protects the FRAME and
+   swap state of every page. */
+void
+frame_table_lock (void)
+{
+  lock_acquire (&frame_lock);
+}
+
+/* Releases the frame table lock. */
+void
+frame_table_unlock (void)
+{
+  lock_release (&frame_lock);
+}
+
+/* Waits until page P of the running thread is not being
+   evicted.  The frame table lock must be held. */
+void
+frame_wait (struct page *p)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  while (p->frame != NULL && p->frame->pinned)
+    cond_wait (&evicted, &frame_lock);
+}
+
+/* Page-out daemon.  Sleeps until frame_alloc() notices that free
+   user frames are running low, then evicts pages in batches
+   until the high watermark is reached or nothing more can be
+   evicted. */
+static void
+pageout_daemon (void *aux UNUSED)
+{
+  struct victim victims[PAGEOUT_BATCH];
+
+  for (;;)
+    {
+      sema_down (&pageout_sema);
+
+      lock_acquire (&frame_lock);
+      while (palloc_free_cnt (PAL_USER) < high_watermark)
+        {
+          size_t cnt = select_victims (victims, PAGEOUT_BATCH);
+          size_t i;
+
+          if (cnt == 0)
+            break;
+          lock_release (&frame_lock);
+          write_victims (victims, cnt);
+          lock_acquire (&frame_lock);
+
+          for (i = 0; i < cnt; i++)
+            {
+              finish_victim (&victims[i]);
+              remove_frame (victims[i].frame);
+            }
+          pageout_cnt += cnt;
+        }
+      pageout_pending = false;
+      lock_release (&frame_lock);
+    }
+}
+
+/* Returns the frame under the clock hand and advances the hand. */
+static struct frame *
+clock_next (void)
+{
+  struct frame *f;
+
+  if (clock_hand == NULL || clock_hand == list_end (&frame_list))
+    clock_hand = list_begin (&frame_list);
+  f = list_entry (clock_hand, struct frame, elem);
+  clock_hand = list_next (clock_hand);
+  return f;
+}
+
+/* Chooses up to MAX frames to evict with the clock algorithm and
+   stores them in VICTIMS.  Each victim is pinned and unmapped
+   from its owner, and is given a swap slot if its contents must
+   be saved.  Returns the number of victims chosen.  The frame
+   table lock must be held. */
+static size_t
+select_victims (struct victim *victims, size_t max)
+{
+  size_t steps = 2 * list_size (&frame_list);
+  size_t cnt = 0;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  while (steps-- > 0 && cnt < max)
+    {
+      struct frame *f = clock_next ();
+      struct page *p = f->page;
+      uint32_t *pd = f->owner->pagedir;
+      swap_slot_t slot = SWAP_ERROR;
+
+      if (f->pinned)
+        continue;
+      if (pagedir_is_accessed (pd, p->upage))
+        {
+          pagedir_set_accessed (pd, p->upage, false);
+          continue;
+        }
+
+      /* Unmap before looking at the dirty bit, so that the owner
+         cannot dirty the page after we have decided it is
+         clean. */
+      pagedir_clear_page (pd, p->upage);
+      if (p->type == PAGE_SWAP || pagedir_is_dirty (pd, p->upage))
+        {
+          slot = swap_alloc ();
+          if (slot == SWAP_ERROR)
+            {
+              /* Nowhere to put it.  Map it back and move on. */
+              pagedir_set_page (pd, p->upage, f->kpage, p->writable);
+              pagedir_set_dirty (pd, p->upage, true);
+              continue;
+            }
+        }
+
+      f->pinned = true;
+      victims[cnt].frame = f;
+      victims[cnt].slot = slot;
+      cnt++;
+    }
+  return cnt;
+}
+
+/* Writes the victims among the CNT in VICTIMS that need it to
+   swap.  Must be called without the frame table lock held. */
+static void
+write_victims (struct victim *victims, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (victims[i].slot != SWAP_ERROR)
+      {
+        swap_write (victims[i].slot, victims[i].frame->kpage);
+        swap_out_cnt++;
+      }
+}
+
+/* Detaches victim V's frame from its page, recording where the
+   page's contents went, and wakes up any thread waiting for the
+   page.  The frame itself stays pinned and in the table.  The
+   frame table lock must be held. */
+static void
+finish_victim (struct victim *v)
+{
+  struct page *p = v->frame->page;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (v->slot != SWAP_ERROR)
+    {
+      p->type = PAGE_SWAP;
+      p->swap_slot = v->slot;
+    }
+  p->frame = NULL;
+  v->frame->page = NULL;
+  cond_broadcast (&evicted, &frame_lock);
+}
+
+/* Removes F from the frame table and frees it and its memory.
+   The frame table lock must be held. */
+static void
+remove_frame (struct frame *f)
+{
+  if (clock_hand == &f->elem)
+    clock_hand = list_next (clock_hand);
+  list_remove (&f->elem);
+  palloc_free_page (f->kpage);
+  free (f);
+}
@@ -0,0 +1,36 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <list.h>
+#include <stdbool.h>
+
+struct page;
+
+/* A user frame holding a page of some process.
+
+   A frame is "pinned" while its owner is filling it or while the
+   page-out daemon is writing it out.  Pinned frames are never
+   chosen for eviction, and a process that faults on a page whose
+   frame is being evicted waits for the eviction to finish. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address. */
+    struct page *page;          /* Page held in this frame. */
+    struct thread *owner;       /* Thread whose address space has PAGE. */
+    bool pinned;                /* Being loaded or evicted? */
+    struct list_elem elem;      /* Element in the frame table. */
+  };
+
+void frame_init (void);
+void frame_print_stats (void);
+
+struct frame *frame_alloc (struct page *, bool zero);
+void frame_unpin (struct frame *);
+void frame_free (struct frame *);
+bool frame_memory_low (void);
+
+void frame_table_lock (void);
+void frame_table_unlock (void);
+void frame_wait (struct page *);
+
+#endif /* vm/frame.h */
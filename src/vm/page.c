@@ -0,0 +1,431 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+
+/* The shared zero frame.  Every untouched PAGE_ZERO page in
+   every process is mapped read-only onto this one frame, which
+   is never written and never freed. */
+static void *zero_frame;
+
+/* Lowest address a user stack may grow down to. */
+static uint8_t *stack_floor;
+
+/* An access this many bytes below the stack pointer can still be
+   a legitimate push: PUSHA stores 32 bytes before it updates
+   %esp. */
+#define STACK_SLOP 32
+
+/* Number of pages in the window mapped around a faulting
+   file-backed page.  0 or 1 disables fault-around. */
+static size_t fault_around_pages;
+
+/* Statistics. */
+static long long file_fault_cnt;   /* # of faults loading file pages. */
+static long long fault_around_cnt; /* # of pages mapped by fault-around. */
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_destroy;
+
+static bool is_stack_access (const void *fault_addr, const void *esp);
+static bool page_map_zero (struct page *);
+static bool page_make_private (struct page *);
+static bool page_load (struct page *, bool keep_pinned);
+static bool page_swap_in (struct page *);
+static void page_fault_around (struct page *);
+
+/* Allocates the shared zero frame, lets user stacks grow to at
+   most STACK_PAGE_LIMIT pages, and makes a fault on a
+   file-backed page also map the rest of the FAULT_AROUND_PAGES
+   page window around it. */
+void
+page_init (size_t stack_page_limit, size_t fault_around_pages_)
+{
+  size_t max_pages = (uintptr_t) PHYS_BASE / PGSIZE - 1;
+
+  zero_frame = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  if (stack_page_limit > max_pages)
+    stack_page_limit = max_pages;
+  stack_floor = (uint8_t *) PHYS_BASE - stack_page_limit * PGSIZE;
+  fault_around_pages = fault_around_pages_;
+}
+
+/* Prints virtual memory statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Page: %lld file faults, %lld pages mapped by fault-around\n",
+          file_fault_cnt, fault_around_cnt);
+}
+
+/* Initializes supplemental page table PAGES.
+   Returns false if memory allocation fails. */
+bool
+page_table_init (struct hash *pages)
+{
+  return hash_init (pages, page_hash, page_less, NULL);
+}
+
+/* Destroys the running thread's supplemental page table PAGES,
+   releasing every page's frame or swap slot and unmapping it,
+   so that pagedir_destroy() is left with only the page tables
+   themselves to free. */
+void
+page_table_destroy (struct hash *pages)
+{
+  struct thread *t = thread_current ();
+
+  /* Unmap the whole address space up front, with a single TLB
+     flush, rather than invalidating one page at a time below. */
+  if (t->pagedir != NULL)
+    pagedir_clear_range (t->pagedir, NULL, pg_no (PHYS_BASE));
+  hash_destroy (pages, page_destroy);
+}
+
+/* Returns the running thread's page that contains UPAGE, or a
+   null pointer if there is none. */
+struct page *
+page_lookup (const void *upage)
+{
+  struct thread *t = thread_current ();
+  struct page p;
+  struct hash_elem *e;
+
+  p.upage = pg_round_down (upage);
+  e = hash_find (&t->pages, &p.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Creates a page at UPAGE of the given TYPE in the running
+   thread's supplemental page table and returns it, or returns a
+   null pointer if UPAGE is already in use or memory allocation
+   fails. */
+static struct page *
+page_create (void *upage, enum page_type type, bool writable)
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+
+  if (pagedir_get_page (t->pagedir, upage) != NULL)
+    return NULL;
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->frame = NULL;
+  p->writable = writable;
+  p->type = type;
+  p->file = NULL;
+  p->ofs = 0;
+  p->read_bytes = 0;
+  p->swap_slot = SWAP_ERROR;
+
+  if (hash_insert (&t->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Adds a zero-filled page at UPAGE to the running thread's
+   address space and maps it read-only onto the zero frame.
+   No memory is allocated for the page's contents until it is
+   first written.  Returns false if UPAGE is already in use or
+   if memory allocation fails. */
+bool
+page_add_zero (void *upage, bool writable)
+{
+  struct thread *t = thread_current ();
+  struct page *p = page_create (upage, PAGE_ZERO, writable);
+
+  if (p == NULL)
+    return false;
+  if (!page_map_zero (p))
+    {
+      hash_delete (&t->pages, &p->hash_elem);
+      free (p);
+      return false;
+    }
+  return true;
+}
+
+/* Adds a page at UPAGE to the running thread's address space
+   whose contents are READ_BYTES bytes of FILE starting at OFS,
+   followed by zeros.  Nothing is read or mapped until the page
+   is first accessed.  Returns false if UPAGE is already in use
+   or if memory allocation fails. */
+bool
+page_add_file (void *upage, struct file *file, off_t ofs,
+               uint32_t read_bytes, bool writable)
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = page_create (upage, PAGE_FILE, writable);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  return true;
+}
+
+/* Attempts to resolve a page fault at FAULT_ADDR in the running
+   thread's address space.  ESP is the user stack pointer at the
+   time of the fault.  NOT_PRESENT and WRITE describe the fault
+   as in page_fault().  Returns true if the faulting access may
+   be retried, false if it is a genuine access violation. */
+bool
+page_fault_resolve (void *fault_addr, void *esp,
+                    bool not_present, bool write)
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+  bool in_frame;
+
+  if (!is_user_vaddr (fault_addr) || t->pagedir == NULL)
+    return false;
+
+  p = page_lookup (fault_addr);
+  if (p == NULL)
+    {
+      /* Grow the stack by the one page that was touched. */
+      if (!not_present || !is_stack_access (fault_addr, esp)
+          || !page_add_zero (pg_round_down (fault_addr), true))
+        return false;
+      p = page_lookup (fault_addr);
+    }
+  if (write && !p->writable)
+    return false;
+
+  /* If the page-out daemon is in the middle of evicting the page,
+     wait for it.  If the page is still in its frame, the fault
+     raced with a failed eviction that has mapped it back. */
+  frame_table_lock ();
+  frame_wait (p);
+  in_frame = p->frame != NULL;
+  frame_table_unlock ();
+  if (in_frame)
+    return pagedir_get_page (t->pagedir, p->upage) != NULL;
+
+  switch (p->type)
+    {
+    case PAGE_ZERO:
+      return write ? page_make_private (p) : page_map_zero (p);
+
+    case PAGE_FILE:
+      if (!page_load (p, true))
+        return false;
+      file_fault_cnt++;
+      page_fault_around (p);
+      frame_unpin (p->frame);
+      return true;
+
+    case PAGE_SWAP:
+      return page_swap_in (p);
+    }
+  NOT_REACHED ();
+}
+
+/* Maps zero page P read-only onto the zero frame, if it is not
+   mapped already.  Returns false if memory allocation fails. */
+static bool
+page_map_zero (struct page *p)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (p->type == PAGE_ZERO);
+
+  return (pagedir_get_page (t->pagedir, p->upage) != NULL
+          || pagedir_set_page (t->pagedir, p->upage, zero_frame, false));
+}
+
+/* Gives zero page P a private, zeroed, writable frame in place of
+   the zero frame.  Returns false if no frame is available. */
+static bool
+page_make_private (struct page *p)
+{
+  struct thread *t = thread_current ();
+  struct frame *f;
+
+  ASSERT (p->type == PAGE_ZERO);
+
+  f = frame_alloc (p, true);
+  if (f == NULL)
+    return false;
+  pagedir_clear_page (t->pagedir, p->upage);
+  if (!pagedir_set_page (t->pagedir, p->upage, f->kpage, true))
+    {
+      frame_table_lock ();
+      frame_free (f);
+      frame_table_unlock ();
+      return false;
+    }
+  frame_unpin (f);
+  return true;
+}
+
+/* Reads file-backed page P into a new frame and maps it.  If
+   KEEP_PINNED is true, the frame is left pinned and the caller
+   must unpin it.  Returns false if no frame is available or the
+   read fails. */
+static bool
+page_load (struct page *p, bool keep_pinned)
+{
+  struct thread *t = thread_current ();
+  struct frame *f;
+  off_t bytes;
+
+  ASSERT (p->type == PAGE_FILE);
+  ASSERT (p->frame == NULL);
+
+  f = frame_alloc (p, false);
+  if (f == NULL)
+    return false;
+
+  bytes = file_read_at (p->file, f->kpage, p->read_bytes, p->ofs);
+  memset ((uint8_t *) f->kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+
+  if (bytes != (off_t) p->read_bytes
+      || !pagedir_set_page (t->pagedir, p->upage, f->kpage, p->writable))
+    {
+      frame_table_lock ();
+      frame_free (f);
+      frame_table_unlock ();
+      return false;
+    }
+  if (!keep_pinned)
+    frame_unpin (f);
+  return true;
+}
+
+/* Reads page P back in from swap and maps it.
+   Returns false if no frame is available. */
+static bool
+page_swap_in (struct page *p)
+{
+  struct thread *t = thread_current ();
+  struct frame *f;
+
+  ASSERT (p->type == PAGE_SWAP);
+  ASSERT (p->swap_slot != SWAP_ERROR);
+
+  f = frame_alloc (p, false);
+  if (f == NULL)
+    return false;
+  swap_read (p->swap_slot, f->kpage);
+  if (!pagedir_set_page (t->pagedir, p->upage, f->kpage, p->writable))
+    {
+      frame_table_lock ();
+      frame_free (f);
+      frame_table_unlock ();
+      return false;
+    }
+  swap_free (p->swap_slot);
+  p->swap_slot = SWAP_ERROR;
+  frame_unpin (f);
+  return true;
+}
+
+/* Maps the file-backed pages in the aligned window of
+   fault_around_pages pages around P that have not been loaded
+   yet, so that a process scanning its image sequentially takes
+   one fault per window instead of one per page.  Stops quietly
+   on the first page that cannot be loaded, or as soon as free
+   frames run low, so that reading ahead never pushes out P or
+   other pages in use; the rest will simply fault on their own
+   later.  P's frame must be pinned. */
+static void
+page_fault_around (struct page *p)
+{
+  uint8_t *start, *end, *upage;
+
+  if (fault_around_pages <= 1)
+    return;
+
+  start = (uint8_t *) p->upage
+          - (pg_no (p->upage) % fault_around_pages) * PGSIZE;
+  end = start + fault_around_pages * PGSIZE;
+  if (end > (uint8_t *) PHYS_BASE || end < start)
+    end = PHYS_BASE;
+
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      struct page *q;
+
+      if (upage == p->upage)
+        continue;
+      q = page_lookup (upage);
+      if (q == NULL || q->type != PAGE_FILE || q->frame != NULL)
+        continue;
+      if (frame_memory_low () || !page_load (q, false))
+        break;
+      fault_around_cnt++;
+    }
+}
+
+/* Returns true if an access to FAULT_ADDR, with the stack
+   pointer at ESP, looks like the stack growing: at or above ESP
+   (or just below it, for PUSH and PUSHA) and within the stack
+   size limit. */
+static bool
+is_stack_access (const void *fault_addr, const void *esp)
+{
+  const uint8_t *addr = fault_addr;
+
+  return addr >= stack_floor
+         && addr >= (const uint8_t *) esp - STACK_SLOP
+         && is_user_vaddr (addr);
+}
+
+/* Returns a hash value for page P. */
+static unsigned
+page_hash (const struct hash_elem *p_, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (p_, struct page, hash_elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
+
+/* Removes page P_ from the running thread's address space and
+   releases its frame or swap slot. */
+static void
+page_destroy (struct hash_elem *p_, void *aux UNUSED)
+{
+  struct page *p = hash_entry (p_, struct page, hash_elem);
+  struct thread *t = thread_current ();
+
+  frame_table_lock ();
+  frame_wait (p);
+  if (t->pagedir != NULL)
+    pagedir_clear_page (t->pagedir, p->upage);
+  if (p->frame != NULL)
+    frame_free (p->frame);
+  else if (p->type == PAGE_SWAP)
+    swap_free (p->swap_slot);
+  frame_table_unlock ();
+  free (p);
+}
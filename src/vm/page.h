@@ -0,0 +1,58 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "vm/swap.h"
+
+/* Where the contents of a virtual page come from when it is not
+   in a frame. */
+enum page_type
+  {
+    PAGE_ZERO,                  /* All zeros until first written. */
+    PAGE_FILE,                  /* Read from a file on first access. */
+    PAGE_SWAP                   /* Only in its frame or in swap. */
+  };
+
+/* A virtual page in a user process's supplemental page table.
+
+   A PAGE_ZERO page that has never been written has no frame of
+   its own: it is mapped read-only onto the shared zero frame,
+   and the first write to it faults and gives it a private,
+   zeroed frame (copy-on-write).  A PAGE_FILE page is not mapped
+   at all until it is first accessed, at which point READ_BYTES
+   bytes are read from FILE at offset OFS and the rest of the
+   page is zeroed.  A page whose frame is evicted after it has
+   been modified becomes a PAGE_SWAP page.
+
+   FRAME and SWAP_SLOT are protected by the frame table lock,
+   since the page-out daemon changes them (see vm/frame.c). */
+struct page
+  {
+    void *upage;                /* User virtual address. */
+    struct frame *frame;        /* Frame holding the page, or null. */
+    bool writable;              /* May the process write the page? */
+    enum page_type type;        /* Where the contents are kept. */
+    struct file *file;          /* PAGE_FILE: file to read from. */
+    off_t ofs;                  /* PAGE_FILE: offset in FILE. */
+    uint32_t read_bytes;        /* PAGE_FILE: bytes to read. */
+    swap_slot_t swap_slot;      /* PAGE_SWAP: slot, if not in a frame. */
+    struct hash_elem hash_elem; /* Element in thread's `pages' table. */
+  };
+
+void page_init (size_t stack_page_limit, size_t fault_around_pages);
+void page_print_stats (void);
+bool page_table_init (struct hash *);
+void page_table_destroy (struct hash *);
+
+struct page *page_lookup (const void *upage);
+bool page_add_zero (void *upage, bool writable);
+bool page_add_file (void *upage, struct file *, off_t ofs,
+                    uint32_t read_bytes, bool writable);
+bool page_fault_resolve (void *fault_addr, void *esp,
+                         bool not_present, bool write);
+
+#endif /* vm/page.h */
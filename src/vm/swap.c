@@ -0,0 +1,81 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Number of sectors per page-sized swap slot. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block *swap_device;   /* Swap device, or null if none. */
+static struct bitmap *used_slots;   /* One bit per slot, true if in use. */
+static struct lock swap_lock;       /* Protects USED_SLOTS. */
+
+/* Finds the swap device and sets up the slot map.  Without a
+   swap device every allocation simply fails, so only pages that
+   can be re-read from their files are ever evicted. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      printf ("swap: no swap device, dirty pages will not be evicted\n");
+      return;
+    }
+  used_slots = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+  if (used_slots == NULL)
+    PANIC ("swap: can't allocate slot map");
+}
+
+/* Reserves a free swap slot and returns it, or SWAP_ERROR if the
+   swap device is full or missing. */
+swap_slot_t
+swap_alloc (void)
+{
+  size_t slot;
+
+  if (used_slots == NULL)
+    return SWAP_ERROR;
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (used_slots, 0, 1, false);
+  lock_release (&swap_lock);
+  return slot != BITMAP_ERROR ? slot : SWAP_ERROR;
+}
+
+/* Releases SLOT. */
+void
+swap_free (swap_slot_t slot)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  bitmap_reset (used_slots, slot);
+  lock_release (&swap_lock);
+}
+
+/* Writes the page at KPAGE to SLOT. */
+void
+swap_write (swap_slot_t slot, const void *kpage)
+{
+  const uint8_t *p = kpage;
+  size_t i;
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, slot * PAGE_SECTORS + i,
+                 p + i * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads SLOT into the page at KPAGE. */
+void
+swap_read (swap_slot_t slot, void *kpage)
+{
+  uint8_t *p = kpage;
+  size_t i;
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_read (swap_device, slot * PAGE_SECTORS + i,
+                p + i * BLOCK_SECTOR_SIZE);
+}
@@ -0,0 +1,17 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* A page-sized slot in the swap device. */
+typedef size_t swap_slot_t;
+#define SWAP_ERROR ((swap_slot_t) -1)
+
+void swap_init (void);
+swap_slot_t swap_alloc (void);
+void swap_free (swap_slot_t);
+void swap_write (swap_slot_t, const void *kpage);
+void swap_read (swap_slot_t, void *kpage);
+
+#endif /* vm/swap.h */